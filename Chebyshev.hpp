@@ -0,0 +1,122 @@
+#ifndef CHEBYSHEV_HPP
+#define CHEBYSHEV_HPP
+
+#include <cmath>
+#include <memory>
+#include "sequences/DynamicArray.hpp"
+
+
+// Сводка по компиляции сегментов в чебышёвские приближения
+struct CompilationReport {
+    size_t segments;
+    size_t skipped;
+    size_t pieces;
+    size_t bytes;
+    double maxError;
+    CompilationReport(): segments(0), skipped(0), pieces(0), bytes(0), maxError(0) {}
+};
+
+// Кусочное приближение функции на [start, end] многочленами Чебышёва степени degree
+// на pieces равных кусках; коэффициенты всех кусков лежат подряд в одном массиве
+class ChebyshevTable {
+    private:
+        DynamicArray<double> coefficients;
+        double start;
+        double end;
+        double scale;
+        size_t pieces;
+        size_t degree;
+    public:
+        // Создание объекта
+        template <typename F>
+        ChebyshevTable(const F &func, double start, double end, size_t degree, size_t pieces);
+        template <typename F>
+        static std::shared_ptr<const ChebyshevTable> Compile(const F &func, double start, double end, double tolerance,
+                                                             double &error, size_t degree = 8, size_t maxPieces = 1 << 16);
+
+        // Декомпозиция
+        size_t GetPieces() const;
+        size_t GetBytes() const;
+
+        // Операции
+        double operator()(double x) const;
+        template <typename F>
+        double MaxError(const F &func) const;
+};
+
+// Создание объекта
+template <typename F>
+ChebyshevTable::ChebyshevTable(const F &func, double start, double end, size_t degree, size_t pieces):
+    coefficients(pieces*(degree+1)), start(start), end(end), scale(pieces/(end-start)), pieces(pieces), degree(degree) {
+    const double pi = std::acos(-1.0);
+    size_t nodes = degree+1;
+    DynamicArray<double> values(nodes);
+    for (size_t piece = 0; piece < pieces; piece++) {
+        double left = start+(end-start)*piece/pieces, right = start+(end-start)*(piece+1)/pieces;
+        double middle = (left+right)/2, half = (right-left)/2;
+        for (size_t j = 0; j < nodes; j++) values[j] = func(middle+half*std::cos(pi*(j+0.5)/nodes));
+        for (size_t k = 0; k < nodes; k++) {
+            double sum = 0;
+            for (size_t j = 0; j < nodes; j++) sum += values[j]*std::cos(pi*k*(j+0.5)/nodes);
+            coefficients[piece*nodes+k] = (k == 0 ? 1.0 : 2.0)*sum/nodes;
+        }
+    }
+}
+
+// Число кусков удваивается, пока ошибка на контрольных точках больше tolerance;
+// nullptr, если функция принимает не конечные значения или и maxPieces кусков не хватило
+// (error тогда - ошибка последней попытки)
+template <typename F>
+std::shared_ptr<const ChebyshevTable> ChebyshevTable::Compile(const F &func, double start, double end, double tolerance,
+                                                              double &error, size_t degree, size_t maxPieces) {
+    for (size_t pieces = 1; pieces <= maxPieces; pieces *= 2) {
+        std::shared_ptr<const ChebyshevTable> table = std::make_shared<const ChebyshevTable>(func, start, end, degree, pieces);
+        error = table->MaxError(func);
+        if (!std::isfinite(error)) return nullptr;
+        if (error <= tolerance) return table;
+    }
+    return nullptr;
+}
+
+// Декомпозиция
+inline size_t ChebyshevTable::GetPieces() const {
+    return pieces;
+}
+
+inline size_t ChebyshevTable::GetBytes() const {
+    return sizeof(ChebyshevTable)+coefficients.GetSize()*sizeof(double);
+}
+
+// Операции
+// Кусок находится арифметикой, значение - схемой Кленшоу (degree умножений-сложений)
+inline double ChebyshevTable::operator()(double x) const {
+    double t = (x-start)*scale;
+    size_t piece = t <= 0 ? 0 : static_cast<size_t>(t);
+    if (piece >= pieces) piece = pieces-1;
+    double u = 2*(t-piece)-1, u2 = 2*u;
+    const double *c = &coefficients[piece*(degree+1)];
+    double b1 = 0, b2 = 0;
+    for (size_t k = degree; k > 0; k--) {
+        double b0 = u2*b1+c[k]-b2;
+        b2 = b1;
+        b1 = b0;
+    }
+    return u*b1+c[0]-b2;
+}
+
+// Наибольшее отклонение от func в 2*(degree+1) точках каждого куска, включая концы
+template <typename F>
+double ChebyshevTable::MaxError(const F &func) const {
+    size_t checks = 2*(degree+1);
+    double error = 0;
+    for (size_t piece = 0; piece < pieces; piece++) {
+        for (size_t k = 0; k <= checks; k++) {
+            double x = start+(end-start)*(piece+double(k)/checks)/pieces;
+            double difference = std::abs((*this)(x)-func(x));
+            if (!(difference <= error)) error = difference;
+        }
+    }
+    return error;
+}
+
+#endif // CHEBYSHEV_HPP
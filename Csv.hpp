@@ -0,0 +1,215 @@
+#ifndef CSV_HPP
+#define CSV_HPP
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstring>
+#include <istream>
+#include <stdexcept>
+#include <string>
+#include "Formula.hpp"
+#include "Parallel.hpp"
+#include "Serialization.hpp"
+#include "sequences/DynamicArray.hpp"
+
+
+// Строка CSV-таблицы: сегмент с формулой и номер строки текста для сообщений об ошибках
+struct CsvRow {
+    double start;
+    double end;
+    Formula formula;
+    size_t line;
+    CsvRow(): start(0), end(0), formula(), line(0) {}
+};
+
+// Разобранная часть куска: строки таблицы, число строк текста и первая ошибка (номер строки внутри части)
+struct CsvPart {
+    DynamicArray<CsvRow> rows;
+    size_t count;
+    size_t lines;
+    size_t errorLine;
+    std::string error;
+    CsvPart(): rows(), count(0), lines(0), errorLine(0), error() {}
+};
+
+// Потоковый разбор таблицы "start,end,kind,коэффициенты..." (kind - constant, linear, quadratic, hyperbolic,
+// power или sine, коэффициенты - поля a, b, c, d формулы) кусками по chunkSize байт: кусок обрезается
+// по последнему переводу строки, хвост переносится в следующий. В параллельном режиме кусок делится
+// по строкам между потоками. Пустые строки, строки с '#' и заголовок "start,..." пропускаются
+class CsvReader {
+    private:
+        static const size_t partGrain = 1 << 16;
+        std::istream &in;
+        bool parallel;
+        DynamicArray<char> buffer;
+        size_t carried;
+        size_t lines;
+        size_t bytes;
+        bool finished;
+        static bool ParseLine(const char *begin, const char *end, CsvRow &row, std::string &error);
+        static void ParsePart(const char *begin, const char *end, bool header, CsvPart &part);
+    public:
+        // Создание объекта
+        CsvReader(std::istream &in, bool parallel = false, size_t chunkSize = 1 << 22);
+        CsvReader(const CsvReader&) = delete;
+        CsvReader& operator=(const CsvReader&) = delete;
+
+        // Декомпозиция
+        size_t GetBytes() const;
+        size_t GetLines() const;
+
+        // Операции
+        bool Next(DynamicArray<CsvRow> &rows, size_t &count);
+};
+
+// Создание объекта
+inline CsvReader::CsvReader(std::istream &in, bool parallel, size_t chunkSize):
+    in(in), parallel(parallel), buffer(std::max<size_t>(chunkSize, 1)), carried(0), lines(0), bytes(0), finished(false) {}
+
+// Поля разделены запятыми, пробелы вокруг полей и '\r' в конце строки отбрасываются
+inline bool CsvReader::ParseLine(const char *begin, const char *end, CsvRow &row, std::string &error) {
+    static const char *kinds[] = {"", "constant", "linear", "quadratic", "hyperbolic", "power", "sine"};
+    auto space = [](char c) {return c == ' ' || c == '\t' || c == '\r';};
+    auto number = [](const char *first, const char *last, double &value) {
+        std::from_chars_result result = std::from_chars(first, last, value);
+        return first != last && result.ec == std::errc() && result.ptr == last;
+    };
+    const char *fields[7][2];
+    size_t count = 0;
+    for (const char *position = begin;;) {
+        const char *comma = static_cast<const char*>(std::memchr(position, ',', end-position));
+        if (!comma) comma = end;
+        if (count == 7) {
+            error = "слишком много полей";
+            return false;
+        }
+        const char *first = position, *last = comma;
+        while (first < last && space(*first)) first++;
+        while (last > first && space(last[-1])) last--;
+        fields[count][0] = first;
+        fields[count][1] = last;
+        count++;
+        if (comma == end) break;
+        position = comma+1;
+    }
+    if (count < 4) {
+        error = "ожидается start,end,kind,коэффициенты";
+        return false;
+    }
+    if (!number(fields[0][0], fields[0][1], row.start) || !number(fields[1][0], fields[1][1], row.end)) {
+        error = "неверная граница сегмента";
+        return false;
+    }
+    std::string kind(fields[2][0], fields[2][1]);
+    size_t index = 1;
+    while (index <= static_cast<size_t>(FormulaKind::Sine) && kind != kinds[index]) index++;
+    if (index > static_cast<size_t>(FormulaKind::Sine)) {
+        error = "неизвестный вид \"" + kind + "\"";
+        return false;
+    }
+    row.formula = Formula();
+    row.formula.kind = static_cast<FormulaKind>(index);
+    size_t coefficients = StoredCoefficients(row.formula.kind);
+    if (count-3 != coefficients) {
+        error = "для вида " + kind + " нужно коэффициентов: " + std::to_string(coefficients);
+        return false;
+    }
+    double *targets[4] = {&row.formula.a, &row.formula.b, &row.formula.c, &row.formula.d};
+    for (size_t i = 0; i < coefficients; i++) {
+        if (!number(fields[3+i][0], fields[3+i][1], *targets[i])) {
+            error = "неверный коэффициент";
+            return false;
+        }
+    }
+    return true;
+}
+
+// Разбирает целые строки [begin, end); на первой ошибке останавливается
+inline void CsvReader::ParsePart(const char *begin, const char *end, bool header, CsvPart &part) {
+    for (const char *position = begin; position < end;) {
+        const char *newline = static_cast<const char*>(std::memchr(position, '\n', end-position));
+        const char *last = newline ? newline : end, *first = position;
+        part.lines++;
+        position = newline ? newline+1 : end;
+        while (first < last && (*first == ' ' || *first == '\t' || *first == '\r')) first++;
+        if (first == last || *first == '#') continue;
+        if (header && part.lines == 1 && std::isalpha(static_cast<unsigned char>(*first))) continue;
+        if (part.count == part.rows.GetSize()) part.rows.Resize(std::max<size_t>(1024, 2*part.count));
+        CsvRow &row = part.rows[part.count];
+        if (!ParseLine(first, last, row, part.error)) {
+            part.errorLine = part.lines;
+            return;
+        }
+        row.line = part.lines;
+        part.count++;
+    }
+}
+
+// Декомпозиция
+inline size_t CsvReader::GetBytes() const {
+    return bytes;
+}
+
+inline size_t CsvReader::GetLines() const {
+    return lines;
+}
+
+// Операции
+// Дописывает строки следующего куска в rows с позиции count; false, когда поток закончился.
+// Строка длиннее куска удваивает буфер
+inline bool CsvReader::Next(DynamicArray<CsvRow> &rows, size_t &count) {
+    if (finished) return false;
+    size_t size, cut;
+    while (true) {
+        if (carried == buffer.GetSize()) buffer.Resize(2*buffer.GetSize());
+        in.read(&buffer[carried], buffer.GetSize()-carried);
+        size_t got = static_cast<size_t>(in.gcount());
+        bytes += got;
+        size = carried+got;
+        if (size < buffer.GetSize()) {
+            finished = true;
+            cut = size;
+            break;
+        }
+        cut = size;
+        while (cut > 0 && buffer[cut-1] != '\n') cut--;
+        if (cut > 0) break;
+        carried = size;
+    }
+
+    const char *text = size > 0 ? &buffer[0] : nullptr;
+    size_t parts = parallel ? ParallelThreads(cut, partGrain) : 1;
+    DynamicArray<size_t> bounds(parts+1);
+    bounds[0] = 0;
+    bounds[parts] = cut;
+    for (size_t p = 1; p < parts; p++) {
+        size_t bound = std::max(bounds[p-1], cut*p/parts);
+        while (bound > 0 && bound < cut && text[bound-1] != '\n') bound++;
+        bounds[p] = bound;
+    }
+    DynamicArray<CsvPart> results(parts);
+    bool header = lines == 0;
+    ParallelFor(parts, 1, [&](size_t, size_t begin, size_t end) {
+        for (size_t p = begin; p < end; p++) ParsePart(text+bounds[p], text+bounds[p+1], header && p == 0, results[p]);
+    });
+
+    for (size_t p = 0; p < parts; p++) {
+        CsvPart &part = results[p];
+        if (!part.error.empty()) {
+            throw std::invalid_argument("Ошибка в CSV (строка " + std::to_string(lines+part.errorLine) + "): " + part.error + "!");
+        }
+        if (count+part.count > rows.GetSize()) rows.Resize(std::max(count+part.count, 2*rows.GetSize()));
+        for (size_t i = 0; i < part.count; i++) {
+            rows[count] = part.rows[i];
+            rows[count].line += lines;
+            count++;
+        }
+        lines += part.lines;
+    }
+    carried = size-cut;
+    if (carried > 0) std::memmove(&buffer[0], &buffer[cut], carried);
+    return true;
+}
+
+#endif // CSV_HPP
@@ -0,0 +1,136 @@
+#ifndef EVALUATIONCACHE_HPP
+#define EVALUATIONCACHE_HPP
+
+#include <stdexcept>
+#include <unordered_map>
+#include "Statistics.hpp"
+#include "sequences/DynamicArray.hpp"
+
+
+// Ограниченный кэш значений f(x) с вытеснением по алгоритму CLOCK
+template <typename T>
+class EvaluationCache {
+    private:
+        DynamicArray<double> *keys;
+        DynamicArray<T> *values;
+        DynamicArray<bool> *referenced;
+        DynamicArray<bool> *occupied;
+        std::unordered_map<double, size_t> slots;
+        size_t capacity;
+        size_t hand;
+        HitStatistics statistics;
+        void Release(size_t slot);
+    public:
+        // Создание объекта
+        EvaluationCache(size_t capacity);
+        ~EvaluationCache();
+        EvaluationCache(const EvaluationCache<T>&) = delete;
+        EvaluationCache<T>& operator=(const EvaluationCache<T>&) = delete;
+
+        // Декомпозиция
+        size_t GetCapacity() const;
+        size_t GetSize() const;
+        HitStatistics GetStatistics() const;
+
+        // Операции
+        bool Find(double x, T &value);
+        void Insert(double x, const T &value);
+        void Invalidate(double start, double end);
+        void Clear();
+};
+
+// Создание объекта
+template <typename T>
+EvaluationCache<T>::EvaluationCache(size_t capacity) {
+    if (capacity == 0) throw std::invalid_argument("Неправильный размер кэша!");
+    this->capacity = capacity;
+    this->hand = 0;
+    this->keys = new DynamicArray<double>(capacity);
+    this->values = new DynamicArray<T>(capacity);
+    this->referenced = new DynamicArray<bool>(capacity);
+    this->occupied = new DynamicArray<bool>(capacity);
+    for (size_t i = 0; i < capacity; i++) {
+        (*referenced)[i] = false;
+        (*occupied)[i] = false;
+    }
+    slots.reserve(capacity);
+}
+
+template <typename T>
+EvaluationCache<T>::~EvaluationCache() {
+    delete keys;
+    delete values;
+    delete referenced;
+    delete occupied;
+}
+
+// Декомпозиция
+template <typename T>
+size_t EvaluationCache<T>::GetCapacity() const {
+    return capacity;
+}
+
+template <typename T>
+size_t EvaluationCache<T>::GetSize() const {
+    return slots.size();
+}
+
+template <typename T>
+HitStatistics EvaluationCache<T>::GetStatistics() const {
+    return statistics;
+}
+
+// Операции
+template <typename T>
+void EvaluationCache<T>::Release(size_t slot) {
+    slots.erase((*keys)[slot]);
+    (*occupied)[slot] = false;
+    (*referenced)[slot] = false;
+}
+
+template <typename T>
+bool EvaluationCache<T>::Find(double x, T &value) {
+    auto found = slots.find(x);
+    if (found == slots.end()) {
+        statistics.misses++;
+        return false;
+    }
+    statistics.hits++;
+    (*referenced)[found->second] = true;
+    value = (*values)[found->second];
+    return true;
+}
+
+template <typename T>
+void EvaluationCache<T>::Insert(double x, const T &value) {
+    if (x != x || slots.count(x) > 0) return;
+    while ((*occupied)[hand] && (*referenced)[hand]) {
+        (*referenced)[hand] = false;
+        hand = (hand+1)%capacity;
+    }
+    if ((*occupied)[hand]) Release(hand);
+    (*keys)[hand] = x;
+    (*values)[hand] = value;
+    (*occupied)[hand] = true;
+    slots[x] = hand;
+    hand = (hand+1)%capacity;
+}
+
+template <typename T>
+void EvaluationCache<T>::Invalidate(double start, double end) {
+    for (size_t i = 0; i < capacity; i++) {
+        if ((*occupied)[i] && start <= (*keys)[i] && (*keys)[i] <= end) Release(i);
+    }
+}
+
+template <typename T>
+void EvaluationCache<T>::Clear() {
+    for (size_t i = 0; i < capacity; i++) {
+        (*occupied)[i] = false;
+        (*referenced)[i] = false;
+    }
+    slots.clear();
+    hand = 0;
+}
+
+#endif // EVALUATIONCACHE_HPP
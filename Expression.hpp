@@ -0,0 +1,381 @@
+#ifndef EXPRESSION_HPP
+#define EXPRESSION_HPP
+
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include "SegmentNode.hpp"
+#include "sequences/DynamicArray.hpp"
+
+
+// Команды регистровой машины: двухместные target = left op right, одноместные target = op(left)
+enum class OpCode: uint8_t {
+    Add, Subtract, Multiply, Divide, Power, Min, Max,
+    Negate, Sin, Cos, Tan, Asin, Acos, Atan, Sinh, Cosh, Tanh, Exp, Log, Sqrt, Abs, Floor, Ceil
+};
+
+struct Instruction {
+    OpCode code;
+    uint16_t target;
+    uint16_t left;
+    uint16_t right;
+};
+
+// Выражение от x, один раз разобранное в байткод: регистр 0 - x, затем константы, затем временные.
+// Константные подвыражения сворачиваются при разборе, x^2 заменяется умножением.
+// Вектор x вычисляется блоками: каждая команда выполняется сразу для всего блока
+class Expression {
+    private:
+        struct Operand {
+            bool constant;
+            double value;
+            uint16_t index;
+        };
+        class Parser;
+        static const uint16_t constantFlag = 0x4000;
+        static const uint16_t temporaryFlag = 0x8000;
+        static const size_t block = 64;
+        static const size_t scalarRegisters = 64;
+        std::shared_ptr<const DynamicArray<Instruction>> code;
+        std::shared_ptr<const DynamicArray<double>> constants;
+        std::string text;
+        size_t registers;
+        uint16_t result;
+        Expression(): code(), constants(), text(), registers(1), result(0) {}
+        static double Apply(OpCode code, double left, double right);
+    public:
+        // Создание объекта
+        static Expression Parse(const std::string &text);
+
+        // Декомпозиция
+        const std::string& GetText() const;
+        size_t GetInstructions() const;
+        size_t GetRegisters() const;
+
+        // Операции
+        double operator()(double x) const;
+        void Evaluate(const double *xs, size_t count, double *results) const;
+};
+
+// Разбор рекурсивным спуском с выдачей команд на ходу:
+// сумма := произведение (('+' | '-') произведение)*; произведение := унарное (('*' | '/') унарное)*;
+// унарное := ('-' | '+') унарное | степень; степень := первичное ('^' унарное)?;
+// первичное := число | x | pi | e | функция '(' сумма [',' сумма] ')' | '(' сумма ')'
+class Expression::Parser {
+    private:
+        const std::string &text;
+        size_t position;
+        DynamicArray<Instruction> code;
+        size_t instructions;
+        DynamicArray<double> constants;
+        size_t constantsCount;
+        uint16_t temporaries;
+        uint16_t maxTemporaries;
+    public:
+        Parser(const std::string &text): text(text), position(0), code(16), instructions(0), constants(8),
+            constantsCount(0), temporaries(0), maxTemporaries(0) {}
+
+        [[noreturn]] void Fail(const std::string &message) const {
+            throw std::invalid_argument("Ошибка в выражении (позиция "+std::to_string(position+1)+"): "+message+"!");
+        }
+
+        void Skip() {
+            while (position < text.size() && std::isspace(static_cast<unsigned char>(text[position]))) position++;
+        }
+
+        bool Accept(char symbol) {
+            Skip();
+            if (position < text.size() && text[position] == symbol) {
+                position++;
+                return true;
+            }
+            return false;
+        }
+
+        void Expect(char symbol) {
+            if (!Accept(symbol)) Fail(std::string("ожидается '")+symbol+"'");
+        }
+
+        // Регистр операнда: константа получает свой регистр при первом использовании
+        uint16_t Materialize(const Operand &operand) {
+            if (!operand.constant) return operand.index;
+            for (size_t i = 0; i < constantsCount; i++) {
+                if (constants[i] == operand.value || (std::isnan(constants[i]) && std::isnan(operand.value))) {
+                    return uint16_t(constantFlag | i);
+                }
+            }
+            if (constantsCount == constants.GetSize()) constants.Resize(2*constantsCount);
+            if (constantsCount >= constantFlag) Fail("слишком много констант");
+            constants[constantsCount] = operand.value;
+            return uint16_t(constantFlag | constantsCount++);
+        }
+
+        // Временные регистры выделяются стеком: правый операнд всегда вычислен позже левого
+        void Release(uint16_t index) {
+            if (index & temporaryFlag) temporaries--;
+        }
+
+        Operand Emit(OpCode opCode, const Operand &left, const Operand *right) {
+            if (left.constant && (!right || right->constant)) {
+                return {true, Apply(opCode, left.value, right ? right->value : 0), 0};
+            }
+            uint16_t leftIndex = Materialize(left), rightIndex = right ? Materialize(*right) : 0;
+            if (right && rightIndex != leftIndex) Release(rightIndex);
+            Release(leftIndex);
+            if (temporaries >= constantFlag) Fail("выражение слишком сложное");
+            uint16_t target = uint16_t(temporaryFlag | temporaries++);
+            if (temporaries > maxTemporaries) maxTemporaries = temporaries;
+            if (instructions == code.GetSize()) code.Resize(2*instructions);
+            code[instructions++] = {opCode, target, leftIndex, rightIndex};
+            return {false, 0, target};
+        }
+
+        Operand Sum() {
+            Operand left = Product();
+            while (true) {
+                if (Accept('+')) {
+                    Operand right = Product();
+                    left = Emit(OpCode::Add, left, &right);
+                } else if (Accept('-')) {
+                    Operand right = Product();
+                    left = Emit(OpCode::Subtract, left, &right);
+                } else {
+                    return left;
+                }
+            }
+        }
+
+        Operand Product() {
+            Operand left = Unary();
+            while (true) {
+                if (Accept('*')) {
+                    Operand right = Unary();
+                    left = Emit(OpCode::Multiply, left, &right);
+                } else if (Accept('/')) {
+                    Operand right = Unary();
+                    left = Emit(OpCode::Divide, left, &right);
+                } else {
+                    return left;
+                }
+            }
+        }
+
+        Operand Unary() {
+            if (Accept('-')) {
+                Operand operand = Unary();
+                return Emit(OpCode::Negate, operand, nullptr);
+            }
+            if (Accept('+')) return Unary();
+            return Exponent();
+        }
+
+        Operand Exponent() {
+            Operand base = Primary();
+            if (!Accept('^')) return base;
+            Operand exponent = Unary();
+            if (exponent.constant && exponent.value == 1) return base;
+            if (exponent.constant && exponent.value == 2 && !base.constant) return Emit(OpCode::Multiply, base, &base);
+            return Emit(OpCode::Power, base, &exponent);
+        }
+
+        Operand Primary() {
+            Skip();
+            if (position >= text.size()) Fail("неожиданный конец");
+            if (Accept('(')) {
+                Operand operand = Sum();
+                Expect(')');
+                return operand;
+            }
+            char symbol = text[position];
+            if (std::isdigit(static_cast<unsigned char>(symbol)) || symbol == '.') {
+                double value = 0;
+                const char *begin = text.data()+position;
+                std::from_chars_result parsed = std::from_chars(begin, text.data()+text.size(), value);
+                if (parsed.ec != std::errc()) Fail("неправильное число");
+                position += parsed.ptr-begin;
+                return {true, value, 0};
+            }
+            if (!std::isalpha(static_cast<unsigned char>(symbol))) Fail(std::string("неожиданный символ '")+symbol+"'");
+            size_t begin = position;
+            while (position < text.size() && std::isalnum(static_cast<unsigned char>(text[position]))) position++;
+            std::string name = text.substr(begin, position-begin);
+            if (name == "x") return {false, 0, 0};
+            if (name == "pi") return {true, std::acos(-1.0), 0};
+            if (name == "e") return {true, std::exp(1.0), 0};
+            static const struct {
+                const char *name;
+                OpCode code;
+                bool binary;
+            } functions[] = {
+                {"sin", OpCode::Sin, false}, {"cos", OpCode::Cos, false}, {"tan", OpCode::Tan, false},
+                {"asin", OpCode::Asin, false}, {"acos", OpCode::Acos, false}, {"atan", OpCode::Atan, false},
+                {"sinh", OpCode::Sinh, false}, {"cosh", OpCode::Cosh, false}, {"tanh", OpCode::Tanh, false},
+                {"exp", OpCode::Exp, false}, {"log", OpCode::Log, false}, {"ln", OpCode::Log, false},
+                {"sqrt", OpCode::Sqrt, false}, {"abs", OpCode::Abs, false}, {"floor", OpCode::Floor, false},
+                {"ceil", OpCode::Ceil, false}, {"pow", OpCode::Power, true}, {"min", OpCode::Min, true},
+                {"max", OpCode::Max, true}
+            };
+            for (const auto &function: functions) {
+                if (name != function.name) continue;
+                Expect('(');
+                Operand argument = Sum();
+                if (!function.binary) {
+                    Expect(')');
+                    return Emit(function.code, argument, nullptr);
+                }
+                Expect(',');
+                Operand second = Sum();
+                Expect(')');
+                return Emit(function.code, argument, &second);
+            }
+            position = begin;
+            Fail("неизвестное имя '"+name+"'");
+        }
+
+        Expression Build() {
+            Operand operand = Sum();
+            Skip();
+            if (position != text.size()) Fail(std::string("лишний символ '")+text[position]+"'");
+            uint16_t resultIndex = Materialize(operand);
+            size_t base = 1+constantsCount;
+            if (base+maxTemporaries >= constantFlag) Fail("выражение слишком сложное");
+            auto relocate = [base](uint16_t index) {
+                if (index & temporaryFlag) return uint16_t(base+(index & ~temporaryFlag));
+                if (index & constantFlag) return uint16_t(1+(index & ~constantFlag));
+                return index;
+            };
+            DynamicArray<Instruction> *program = new DynamicArray<Instruction>(instructions);
+            for (size_t i = 0; i < instructions; i++) {
+                Instruction instruction = code[i];
+                instruction.target = relocate(instruction.target);
+                instruction.left = relocate(instruction.left);
+                instruction.right = relocate(instruction.right);
+                (*program)[i] = instruction;
+            }
+            Expression expression;
+            expression.code.reset(program);
+            expression.constants.reset(new DynamicArray<double>(constantsCount > 0 ? &constants[0] : nullptr, constantsCount));
+            expression.text = text;
+            expression.registers = base+maxTemporaries;
+            expression.result = relocate(resultIndex);
+            return expression;
+        }
+};
+
+// Создание объекта
+inline Expression Expression::Parse(const std::string &text) {
+    Parser parser(text);
+    return parser.Build();
+}
+
+// Декомпозиция
+inline const std::string& Expression::GetText() const {
+    return text;
+}
+
+inline size_t Expression::GetInstructions() const {
+    return code->GetSize();
+}
+
+inline size_t Expression::GetRegisters() const {
+    return registers;
+}
+
+// Операции
+inline double Expression::Apply(OpCode code, double left, double right) {
+    switch (code) {
+        case OpCode::Add: return left+right;
+        case OpCode::Subtract: return left-right;
+        case OpCode::Multiply: return left*right;
+        case OpCode::Divide: return left/right;
+        case OpCode::Power: return std::pow(left, right);
+        case OpCode::Min: return std::fmin(left, right);
+        case OpCode::Max: return std::fmax(left, right);
+        case OpCode::Negate: return -left;
+        case OpCode::Sin: return std::sin(left);
+        case OpCode::Cos: return std::cos(left);
+        case OpCode::Tan: return std::tan(left);
+        case OpCode::Asin: return std::asin(left);
+        case OpCode::Acos: return std::acos(left);
+        case OpCode::Atan: return std::atan(left);
+        case OpCode::Sinh: return std::sinh(left);
+        case OpCode::Cosh: return std::cosh(left);
+        case OpCode::Tanh: return std::tanh(left);
+        case OpCode::Exp: return std::exp(left);
+        case OpCode::Log: return std::log(left);
+        case OpCode::Sqrt: return std::sqrt(left);
+        case OpCode::Abs: return std::fabs(left);
+        case OpCode::Floor: return std::floor(left);
+        case OpCode::Ceil: return std::ceil(left);
+        default: return NAN;
+    }
+}
+
+inline double Expression::operator()(double x) const {
+    if (registers > scalarRegisters) {
+        double value;
+        Evaluate(&x, 1, &value);
+        return value;
+    }
+    double memory[scalarRegisters];
+    memory[0] = x;
+    const DynamicArray<double> &values = *constants;
+    for (size_t i = 0; i < values.GetSize(); i++) memory[i+1] = values[i];
+    const DynamicArray<Instruction> &program = *code;
+    for (size_t i = 0; i < program.GetSize(); i++) {
+        const Instruction &instruction = program[i];
+        memory[instruction.target] = Apply(instruction.code, memory[instruction.left], memory[instruction.right]);
+    }
+    return memory[result];
+}
+
+// Блок из block значений x: каждый регистр - столбец блока, команда - один цикл по столбцу
+inline void Expression::Evaluate(const double *xs, size_t count, double *results) const {
+    DynamicArray<double> memory(registers*block);
+    double *columns = &memory[0];
+    const DynamicArray<double> &values = *constants;
+    for (size_t i = 0; i < values.GetSize(); i++) {
+        for (size_t k = 0; k < block; k++) columns[(i+1)*block+k] = values[i];
+    }
+    const DynamicArray<Instruction> &program = *code;
+    for (size_t from = 0; from < count; from += block) {
+        size_t n = count-from < block ? count-from : block;
+        std::memcpy(columns, xs+from, n*sizeof(double));
+        for (size_t i = 0; i < program.GetSize(); i++) {
+            const Instruction &instruction = program[i];
+            double *target = columns+instruction.target*block;
+            const double *left = columns+instruction.left*block, *right = columns+instruction.right*block;
+            switch (instruction.code) {
+                case OpCode::Add: for (size_t k = 0; k < n; k++) target[k] = left[k]+right[k]; break;
+                case OpCode::Subtract: for (size_t k = 0; k < n; k++) target[k] = left[k]-right[k]; break;
+                case OpCode::Multiply: for (size_t k = 0; k < n; k++) target[k] = left[k]*right[k]; break;
+                case OpCode::Divide: for (size_t k = 0; k < n; k++) target[k] = left[k]/right[k]; break;
+                case OpCode::Negate: for (size_t k = 0; k < n; k++) target[k] = -left[k]; break;
+                case OpCode::Power: for (size_t k = 0; k < n; k++) target[k] = std::pow(left[k], right[k]); break;
+                case OpCode::Sin: for (size_t k = 0; k < n; k++) target[k] = std::sin(left[k]); break;
+                case OpCode::Cos: for (size_t k = 0; k < n; k++) target[k] = std::cos(left[k]); break;
+                case OpCode::Exp: for (size_t k = 0; k < n; k++) target[k] = std::exp(left[k]); break;
+                case OpCode::Log: for (size_t k = 0; k < n; k++) target[k] = std::log(left[k]); break;
+                case OpCode::Sqrt: for (size_t k = 0; k < n; k++) target[k] = std::sqrt(left[k]); break;
+                default:
+                    for (size_t k = 0; k < n; k++) target[k] = Apply(instruction.code, left[k], right[k]);
+                    break;
+            }
+        }
+        std::memcpy(results+from, columns+result*block, n*sizeof(double));
+    }
+}
+
+// Узел сегмента, заданного выражением: по нему пакетное вычисление узнаёт, что сегмент можно считать блоками
+class ExpressionNode: public SegmentNode {
+    public:
+        Expression expression;
+        ExpressionNode(const Expression &expression): expression(expression) {}
+};
+
+#endif // EXPRESSION_HPP
@@ -0,0 +1,430 @@
+#ifndef FORMULA_HPP
+#define FORMULA_HPP
+
+#include <cmath>
+
+
+// Поведение функции на сегменте (Unknown - ещё не проанализирован)
+enum class Monotony {Unknown, Constant, Increasing, Decreasing, None};
+
+// Вид функции сегмента: Opaque - произвольная функция без известного вида
+enum class FormulaKind {Opaque, Constant, Linear, Quadratic, Hyperbolic, Power, Sine};
+
+// Поточечная операция над двумя функциями
+enum class Operation {Add, Subtract, Multiply, Divide, Min, Max};
+
+// Функция известного вида с коэффициентами:
+// Constant: a; Linear: ax+b; Quadratic: ax²+bx+c; Hyperbolic: a/(x+b)+c; Power: x^a; Sine: a*sin(bx+c)+d
+class Formula {
+    public:
+        FormulaKind kind;
+        double a;
+        double b;
+        double c;
+        double d;
+
+        // Создание объекта
+        Formula(): kind(FormulaKind::Opaque), a(0), b(0), c(0), d(0) {}
+        static Formula Constant(double c);
+        static Formula Linear(double a, double b);
+        static Formula Quadratic(double a, double b, double c);
+        static Formula Hyperbolic(double k, double a, double b);
+        static Formula Power(double n);
+        static Formula Sine(double a, double b, double c, double d);
+        static Formula Polynomial(double p2, double p1, double p0);
+
+        // Операции
+        bool IsOpaque() const;
+        bool operator==(const Formula &other) const;
+        double operator()(double x) const;
+        Monotony MonotonyOn(double start, double end) const;
+        bool Integral(double start, double end, double &value) const;
+        bool Inverse(double y, double start, double end, double &x) const;
+        bool Extrema(double start, double end, double &low, double &high) const;
+        bool Coefficients(double &p2, double &p1, double &p0) const;
+        bool Affine(double scale, double shift, Formula &result) const;
+        bool Compose(const Formula &inner, Formula &result) const;
+        static bool Combine(Operation operation, const Formula &left, const Formula &right, double start, double end, Formula &result);
+};
+
+// Создание объекта
+inline Formula Formula::Constant(double c) {
+    Formula formula;
+    formula.kind = FormulaKind::Constant;
+    formula.a = c;
+    return formula;
+}
+
+inline Formula Formula::Linear(double a, double b) {
+    Formula formula;
+    formula.kind = FormulaKind::Linear;
+    formula.a = a;
+    formula.b = b;
+    return formula;
+}
+
+inline Formula Formula::Quadratic(double a, double b, double c) {
+    Formula formula;
+    formula.kind = FormulaKind::Quadratic;
+    formula.a = a;
+    formula.b = b;
+    formula.c = c;
+    return formula;
+}
+
+inline Formula Formula::Hyperbolic(double k, double a, double b) {
+    Formula formula;
+    formula.kind = FormulaKind::Hyperbolic;
+    formula.a = k;
+    formula.b = a;
+    formula.c = b;
+    return formula;
+}
+
+inline Formula Formula::Power(double n) {
+    Formula formula;
+    formula.kind = FormulaKind::Power;
+    formula.a = n;
+    return formula;
+}
+
+inline Formula Formula::Sine(double a, double b, double c, double d) {
+    Formula formula;
+    formula.kind = FormulaKind::Sine;
+    formula.a = a;
+    formula.b = b;
+    formula.c = c;
+    formula.d = d;
+    return formula;
+}
+
+// Многочлен p2x²+p1x+p0 в виде наименьшей степени
+inline Formula Formula::Polynomial(double p2, double p1, double p0) {
+    if (p2 != 0) return Quadratic(p2, p1, p0);
+    if (p1 != 0) return Linear(p1, p0);
+    return Constant(p0);
+}
+
+// Операции
+inline bool Formula::IsOpaque() const {
+    return kind == FormulaKind::Opaque;
+}
+
+inline bool Formula::operator==(const Formula &other) const {
+    return kind == other.kind && a == other.a && b == other.b && c == other.c && d == other.d;
+}
+
+inline double Formula::operator()(double x) const {
+    switch (kind) {
+        case FormulaKind::Constant: return a;
+        case FormulaKind::Linear: return a*x+b;
+        case FormulaKind::Quadratic: return a*x*x+b*x+c;
+        case FormulaKind::Hyperbolic: return a/(x+b)+c;
+        case FormulaKind::Power: return std::pow(x, a);
+        case FormulaKind::Sine: return a*std::sin(b*x+c)+d;
+        default: return NAN;
+    }
+}
+
+// Монотонность на [start, end] по знаку производной (Unknown для Opaque)
+inline Monotony Formula::MonotonyOn(double start, double end) const {
+    auto direction = [](double sign) {
+        if (sign > 0) return Monotony::Increasing;
+        if (sign < 0) return Monotony::Decreasing;
+        return Monotony::Constant;
+    };
+    switch (kind) {
+        case FormulaKind::Constant:
+            return Monotony::Constant;
+        case FormulaKind::Linear:
+            return direction(a);
+        case FormulaKind::Quadratic: {
+            if (a == 0) return direction(b);
+            double vertex = -b/(2*a);
+            if (vertex <= start) return direction(a);
+            if (vertex >= end) return direction(-a);
+            return Monotony::None;
+        }
+        case FormulaKind::Hyperbolic:
+            if (a == 0) return Monotony::Constant;
+            if (start <= -b && -b <= end) return Monotony::None;
+            return direction(-a);
+        case FormulaKind::Power: {
+            if (a == 0) return Monotony::Constant;
+            bool integer = std::floor(a) == a;
+            if (start >= 0) {
+                if (start == 0 && a < 0) return Monotony::None;
+                return direction(a);
+            }
+            if (!integer) return Monotony::None;
+            bool odd = std::fmod(std::abs(a), 2) == 1;
+            if (end <= 0) {
+                if (end == 0 && a < 0) return Monotony::None;
+                return direction(odd ? a : -a);
+            }
+            return odd && a > 0 ? Monotony::Increasing : Monotony::None;
+        }
+        case FormulaKind::Sine: {
+            if (a == 0 || b == 0) return Monotony::Constant;
+            const double pi = std::acos(-1.0);
+            double from = std::fmin(b*start, b*end)+c, to = std::fmax(b*start, b*end)+c;
+            double critical = pi/2+std::ceil((from-pi/2)/pi)*pi;
+            if (critical == from) critical += pi;
+            if (critical < to) return Monotony::None;
+            return direction(a*b*std::cos((from+to)/2));
+        }
+        default:
+            return Monotony::Unknown;
+    }
+}
+
+// Интеграл по [start, end] через первообразную; false, если её нет (Opaque, полюс или корень из отрицательного)
+inline bool Formula::Integral(double start, double end, double &value) const {
+    switch (kind) {
+        case FormulaKind::Constant:
+            value = a*(end-start);
+            return true;
+        case FormulaKind::Linear:
+            value = (a/2*(end+start)+b)*(end-start);
+            return true;
+        case FormulaKind::Quadratic:
+            value = (a/3*(end*end+end*start+start*start)+b/2*(end+start)+c)*(end-start);
+            return true;
+        case FormulaKind::Hyperbolic:
+            if (a != 0 && start <= -b && -b <= end) return false;
+            value = (a == 0 ? 0 : a*std::log(std::abs((end+b)/(start+b))))+c*(end-start);
+            return true;
+        case FormulaKind::Power: {
+            if (start < 0 && std::floor(a) != a) return false;
+            if (a <= -1 && start <= 0 && 0 <= end) return false;
+            if (a == -1) value = std::log(std::abs(end/start));
+            else value = (std::pow(end, a+1)-std::pow(start, a+1))/(a+1);
+            return true;
+        }
+        case FormulaKind::Sine:
+            if (b == 0) value = (a*std::sin(c)+d)*(end-start);
+            else value = a/b*(std::cos(b*start+c)-std::cos(b*end+c))+d*(end-start);
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Минимум и максимум на [start, end] по значениям на концах и в критических точках;
+// при полюсе внутри отрезка - бесконечности, false для Opaque и корня из отрицательного
+inline bool Formula::Extrema(double start, double end, double &low, double &high) const {
+    if (kind == FormulaKind::Opaque) return false;
+    if (kind == FormulaKind::Power && start < 0 && std::floor(a) != a) return false;
+    bool pole = (kind == FormulaKind::Hyperbolic && a != 0 && start <= -b && -b <= end) ||
+                (kind == FormulaKind::Power && a < 0 && start <= 0 && 0 <= end);
+    auto include = [&low, &high](double value) {
+        low = std::fmin(low, value);
+        high = std::fmax(high, value);
+    };
+    // По обе стороны полюса функция монотонна и уходит в бесконечность: a/(x+b) слева к -sign(a)*inf,
+    // справа к +sign(a)*inf; x^-n справа к +inf, слева к +inf при чётном n и к -inf при нечётном
+    if (pole) {
+        double position = kind == FormulaKind::Hyperbolic ? -b : 0, left, right;
+        if (kind == FormulaKind::Hyperbolic) {
+            left = a > 0 ? -INFINITY : INFINITY;
+            right = -left;
+        } else {
+            left = std::fmod(std::abs(a), 2) == 1 ? -INFINITY : INFINITY;
+            right = INFINITY;
+        }
+        low = INFINITY;
+        high = -INFINITY;
+        if (start < position) {
+            include((*this)(start));
+            include(left);
+        }
+        if (position < end) {
+            include((*this)(end));
+            include(right);
+        }
+        return true;
+    }
+    low = std::fmin((*this)(start), (*this)(end));
+    high = std::fmax((*this)(start), (*this)(end));
+    if (kind == FormulaKind::Quadratic && a != 0) {
+        double vertex = -b/(2*a);
+        if (start < vertex && vertex < end) include((*this)(vertex));
+    } else if (kind == FormulaKind::Power && start < 0 && 0 < end) {
+        include(0);
+    } else if (kind == FormulaKind::Sine && a != 0 && b != 0) {
+        const double pi = std::acos(-1.0);
+        double from = std::fmin(b*start, b*end)+c, to = std::fmax(b*start, b*end)+c;
+        double critical = pi/2+std::ceil((from-pi/2)/pi)*pi;
+        if (critical < to) include(a*std::sin(critical)+d);
+        if (critical+pi < to) include(a*std::sin(critical+pi)+d);
+    }
+    return true;
+}
+
+// Решение f(x) = y на [start, end] в явном виде; false, если решения в отрезке нет или вид неизвестен
+inline bool Formula::Inverse(double y, double start, double end, double &x) const {
+    double slack = 1e-9*(end-start);
+    auto accept = [&x, start, end, slack](double candidate) {
+        if (!(start-slack <= candidate && candidate <= end+slack)) return false;
+        x = std::fmin(std::fmax(candidate, start), end);
+        return true;
+    };
+    switch (kind) {
+        case FormulaKind::Linear:
+            return a != 0 && accept((y-b)/a);
+        case FormulaKind::Quadratic: {
+            if (a == 0) return b != 0 && accept((y-c)/b);
+            double discriminant = b*b-4*a*(c-y);
+            if (discriminant < 0) return false;
+            double q = -(b+(b >= 0 ? 1 : -1)*std::sqrt(discriminant))/2;
+            return accept(q/a) || (q != 0 && accept((c-y)/q));
+        }
+        case FormulaKind::Hyperbolic:
+            return a != 0 && y != c && accept(a/(y-c)-b);
+        case FormulaKind::Power: {
+            if (a == 0) return false;
+            if (y == 0) return a > 0 && accept(0);
+            bool odd = std::floor(a) == a && std::fmod(std::abs(a), 2) == 1;
+            if (y < 0) return odd && accept(-std::pow(-y, 1/a));
+            return accept(std::pow(y, 1/a)) || (std::floor(a) == a && !odd && accept(-std::pow(y, 1/a)));
+        }
+        case FormulaKind::Sine: {
+            if (a == 0 || b == 0) return false;
+            double ratio = (y-d)/a;
+            if (std::abs(ratio) > 1+1e-12) return false;
+            const double pi = std::acos(-1.0);
+            double base = std::asin(std::fmax(-1.0, std::fmin(1.0, ratio)));
+            double from = std::fmin(b*start, b*end)+c, to = std::fmax(b*start, b*end)+c;
+            for (double phase: {base, pi-base}) {
+                double u = phase+std::round(((from+to)/2-phase)/(2*pi))*2*pi;
+                if (accept((u-c)/b)) return true;
+            }
+            return false;
+        }
+        default:
+            return false;
+    }
+}
+
+// Коэффициенты многочлена степени не выше второй; false для остальных видов
+inline bool Formula::Coefficients(double &p2, double &p1, double &p0) const {
+    p2 = p1 = p0 = 0;
+    switch (kind) {
+        case FormulaKind::Constant: p0 = a; return true;
+        case FormulaKind::Linear: p1 = a; p0 = b; return true;
+        case FormulaKind::Quadratic: p2 = a; p1 = b; p0 = c; return true;
+        case FormulaKind::Power:
+            if (a == 0) p0 = 1;
+            else if (a == 1) p1 = 1;
+            else if (a == 2) p2 = 1;
+            else return false;
+            return true;
+        default:
+            return false;
+    }
+}
+
+// scale*f(x)+shift; false, если результат не выражается формулой
+inline bool Formula::Affine(double scale, double shift, Formula &result) const {
+    double p2, p1, p0;
+    if (kind == FormulaKind::Opaque) return false;
+    if (scale == 0) {
+        result = Constant(shift);
+        return true;
+    }
+    if (Coefficients(p2, p1, p0)) {
+        result = Polynomial(scale*p2, scale*p1, scale*p0+shift);
+        return true;
+    }
+    switch (kind) {
+        case FormulaKind::Hyperbolic:
+            result = Hyperbolic(scale*a, b, scale*c+shift);
+            return true;
+        case FormulaKind::Sine:
+            result = Sine(scale*a, b, c, scale*d+shift);
+            return true;
+        default:
+            if (scale != 1 || shift != 0) return false;
+            result = *this;
+            return true;
+    }
+}
+
+// f(inner(x)): подстановка линейной функции в любую формулу или любой формулы в линейную
+inline bool Formula::Compose(const Formula &inner, Formula &result) const {
+    double q2, q1, q0, p2, p1, p0;
+    if (kind == FormulaKind::Opaque || inner.kind == FormulaKind::Opaque) return false;
+    bool polynomial = Coefficients(q2, q1, q0);
+    if (polynomial && q2 == 0) return inner.Affine(q1, q0, result);
+    if (!inner.Coefficients(p2, p1, p0) || p2 != 0) return false;
+    if (p1 == 0) {
+        result = Constant((*this)(p0));
+        return true;
+    }
+    if (polynomial) {
+        result = Polynomial(q2*p1*p1, (2*q2*p0+q1)*p1, (q2*p0+q1)*p0+q0);
+        return true;
+    }
+    switch (kind) {
+        case FormulaKind::Hyperbolic:
+            result = Hyperbolic(a/p1, (p0+b)/p1, c);
+            return true;
+        case FormulaKind::Sine:
+            result = Sine(a, b*p1, b*p0+c, d);
+            return true;
+        default:
+            if (p1 != 1 || p0 != 0) return false;
+            result = *this;
+            return true;
+    }
+}
+
+// Символьная операция над формулами на [start, end]: сложение и умножение многочленов до второй степени,
+// сдвиг и масштаб постоянной, деление постоянной на линейную, min/max при непересекающихся значениях
+inline bool Formula::Combine(Operation operation, const Formula &left, const Formula &right, double start, double end, Formula &result) {
+    if (left.IsOpaque() || right.IsOpaque()) return false;
+    double l2, l1, l0, r2, r1, r0;
+    bool leftPolynomial = left.Coefficients(l2, l1, l0), rightPolynomial = right.Coefficients(r2, r1, r0);
+    bool leftConstant = leftPolynomial && l2 == 0 && l1 == 0, rightConstant = rightPolynomial && r2 == 0 && r1 == 0;
+    switch (operation) {
+        case Operation::Add:
+        case Operation::Subtract: {
+            double sign = operation == Operation::Add ? 1 : -1;
+            if (leftPolynomial && rightPolynomial) {
+                result = Polynomial(l2+sign*r2, l1+sign*r1, l0+sign*r0);
+                return true;
+            }
+            if (rightConstant) return left.Affine(1, sign*r0, result);
+            if (leftConstant) return right.Affine(sign, l0, result);
+            return false;
+        }
+        case Operation::Multiply:
+            if (leftPolynomial && rightPolynomial && l2*r2 == 0 && l2*r1 == 0 && l1*r2 == 0) {
+                result = Polynomial(l2*r0+l1*r1+l0*r2, l1*r0+l0*r1, l0*r0);
+                return true;
+            }
+            if (rightConstant) return left.Affine(r0, 0, result);
+            if (leftConstant) return right.Affine(l0, 0, result);
+            return false;
+        case Operation::Divide:
+            if (rightConstant) return r0 != 0 && left.Affine(1/r0, 0, result);
+            if (leftConstant && rightPolynomial && r2 == 0) {
+                result = Hyperbolic(l0/r1, r0/r1, 0);
+                return true;
+            }
+            return false;
+        case Operation::Min:
+        case Operation::Max: {
+            double leftLow, leftHigh, rightLow, rightHigh;
+            if (!left.Extrema(start, end, leftLow, leftHigh) || !right.Extrema(start, end, rightLow, rightHigh)) return false;
+            bool below = leftHigh <= rightLow, above = rightHigh <= leftLow;
+            if (!below && !above) return false;
+            result = below == (operation == Operation::Min) ? left : right;
+            return true;
+        }
+        default:
+            return false;
+    }
+}
+
+#endif // FORMULA_HPP
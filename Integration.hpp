@@ -0,0 +1,93 @@
+#ifndef INTEGRATION_HPP
+#define INTEGRATION_HPP
+
+#include <cmath>
+#include "sequences/DynamicArray.hpp"
+
+
+// Значение интеграла и оценка его абсолютной погрешности
+struct IntegrationResult {
+    double value;
+    double error;
+    IntegrationResult(): value(0), error(0) {}
+    IntegrationResult(double value, double error): value(value), error(error) {}
+    IntegrationResult& operator+=(const IntegrationResult &other) {
+        value += other.value;
+        error += other.error;
+        return *this;
+    }
+};
+
+// Префиксные суммы интегралов по сегментам и числа разрывов области перед каждым сегментом;
+// элементы [0, valid) актуальны, tolerance - допуск на единицу длины сегмента
+struct PrefixIntegrals {
+    DynamicArray<IntegrationResult> sums;
+    DynamicArray<size_t> gaps;
+    size_t valid;
+    double tolerance;
+    PrefixIntegrals(double tolerance): sums(), gaps(), valid(0), tolerance(tolerance) {}
+};
+
+// Одно применение правила Гаусса-Кронрода G7-K15 на [a, b];
+// погрешность - разность между оценками по 15 и по 7 узлам
+template <typename F>
+IntegrationResult GaussKronrod(const F &func, double a, double b) {
+    static const double nodes[8] = {
+        0.991455371120812639206854697526329, 0.949107912342758524526189684047851,
+        0.864864423359769072789712788640926, 0.741531185599394439863864773280788,
+        0.586087235467691130294144845693013, 0.405845151377397166906606412076961,
+        0.207784955007898467600689403773245, 0.000000000000000000000000000000000
+    };
+    static const double kronrod[8] = {
+        0.022935322010529224963732008058970, 0.063092092629978553290700663189204,
+        0.104790010322250183839876322541518, 0.140653259715525918745189590510238,
+        0.169004726639267902826583426598550, 0.190350578064785409913256402421014,
+        0.204432940075298892414161999234649, 0.209482141084727828012999174891714
+    };
+    static const double gauss[4] = {
+        0.129484966168869693270611432679082, 0.279705391489276667901467771423780,
+        0.381830050505118944950369775488975, 0.417959183673469387755102040816327
+    };
+    double center = (a+b)/2, half = (b-a)/2;
+    double middle = func(center);
+    double kronrodSum = kronrod[7]*middle, gaussSum = gauss[3]*middle;
+    for (int i = 0; i < 7; i++) {
+        double left = func(center-half*nodes[i]), right = func(center+half*nodes[i]);
+        kronrodSum += kronrod[i]*(left+right);
+        if (i%2 == 1) gaussSum += gauss[i/2]*(left+right);
+    }
+    return IntegrationResult(kronrodSum*half, std::abs((kronrodSum-gaussSum)*half));
+}
+
+// Адаптивное интегрирование (как QAG): отрезок с наибольшей погрешностью делится пополам,
+// пока общая погрешность больше tolerance и число отрезков меньше limit
+template <typename F>
+IntegrationResult AdaptiveGaussKronrod(const F &func, double a, double b, double tolerance, size_t limit = 200) {
+    IntegrationResult total = GaussKronrod(func, a, b);
+    if (total.error <= tolerance || limit < 2) return total;
+    DynamicArray<double> starts(limit), ends(limit);
+    DynamicArray<IntegrationResult> parts(limit);
+    starts[0] = a;
+    ends[0] = b;
+    parts[0] = total;
+    size_t count = 1;
+    while (total.error > tolerance && count < limit) {
+        size_t worst = 0;
+        for (size_t i = 1; i < count; i++) {
+            if (parts[i].error > parts[worst].error) worst = i;
+        }
+        double middle = (starts[worst]+ends[worst])/2;
+        if (!(total.error == total.error) || middle <= starts[worst] || middle >= ends[worst]) break;
+        starts[count] = middle;
+        ends[count] = ends[worst];
+        ends[worst] = middle;
+        parts[worst] = GaussKronrod(func, starts[worst], middle);
+        parts[count] = GaussKronrod(func, middle, ends[count]);
+        count++;
+        total = IntegrationResult();
+        for (size_t i = 0; i < count; i++) total += parts[i];
+    }
+    return total;
+}
+
+#endif // INTEGRATION_HPP
@@ -0,0 +1,97 @@
+#ifndef MAPPEDFILE_HPP
+#define MAPPEDFILE_HPP
+
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+// Файл, целиком отображённый в память только для чтения: страницы подгружаются по обращению
+// и через кэш страниц общие для всех процессов, отобразивших тот же файл
+class MappedFile {
+    private:
+        const unsigned char *data;
+        size_t size;
+    public:
+        // Создание объекта
+        explicit MappedFile(const std::string &path);
+        ~MappedFile();
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        // Декомпозиция
+        const unsigned char* GetData() const;
+        size_t GetSize() const;
+};
+
+// Создание объекта
+// Дескрипторы закрываются сразу: отображение держится само до munmap/UnmapViewOfFile
+#ifdef _WIN32
+inline MappedFile::MappedFile(const std::string &path): data(nullptr), size(0) {
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) throw std::runtime_error("Не удалось открыть файл " + path + "!");
+    LARGE_INTEGER length;
+    if (!GetFileSizeEx(file, &length)) {
+        CloseHandle(file);
+        throw std::runtime_error("Не удалось открыть файл " + path + "!");
+    }
+    size = static_cast<size_t>(length.QuadPart);
+    if (size > 0) {
+        HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping) {
+            data = static_cast<const unsigned char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+            CloseHandle(mapping);
+        }
+    }
+    CloseHandle(file);
+    if (size > 0 && !data) throw std::runtime_error("Не удалось отобразить файл " + path + " в память!");
+}
+
+inline MappedFile::~MappedFile() {
+    if (data) UnmapViewOfFile(data);
+}
+#else
+inline MappedFile::MappedFile(const std::string &path): data(nullptr), size(0) {
+    int descriptor = open(path.c_str(), O_RDONLY);
+    if (descriptor < 0) throw std::runtime_error("Не удалось открыть файл " + path + "!");
+    struct stat status;
+    if (fstat(descriptor, &status) != 0) {
+        close(descriptor);
+        throw std::runtime_error("Не удалось открыть файл " + path + "!");
+    }
+    size = static_cast<size_t>(status.st_size);
+    if (size > 0) {
+        void *address = mmap(nullptr, size, PROT_READ, MAP_SHARED, descriptor, 0);
+        if (address != MAP_FAILED) data = static_cast<const unsigned char*>(address);
+    }
+    close(descriptor);
+    if (size > 0 && !data) throw std::runtime_error("Не удалось отобразить файл " + path + " в память!");
+}
+
+inline MappedFile::~MappedFile() {
+    if (data) munmap(const_cast<unsigned char*>(data), size);
+}
+#endif
+
+// Декомпозиция
+inline const unsigned char* MappedFile::GetData() const {
+    return data;
+}
+
+inline size_t MappedFile::GetSize() const {
+    return size;
+}
+
+#endif // MAPPEDFILE_HPP
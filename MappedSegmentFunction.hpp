@@ -0,0 +1,179 @@
+#ifndef MAPPEDSEGMENTFUNCTION_HPP
+#define MAPPEDSEGMENTFUNCTION_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include "MappedFile.hpp"
+#include "SegmentFunction.hpp"
+
+
+// Сегмент замороженной таблицы в том виде, как он лежит в файле
+struct FrozenRecord {
+    double start;
+    double end;
+    uint64_t kind;
+    double a;
+    double b;
+    double c;
+    double d;
+};
+
+static_assert(sizeof(FrozenRecord) == frozenRecordSize, "Запись замороженной таблицы должна занимать 56 байт");
+
+// Неизменяемая функция поверх отображённой в память замороженной таблицы (SegmentFunction::Save(out, true)):
+// границы и коэффициенты читаются прямо из файла без разбора и копирования, поэтому открытие занимает O(1),
+// а физическая память под таблицу общая у всех процессов. Порядок сегментов не перепроверяется - файл
+// считается записанным Save. Копии объекта разделяют одно отображение
+class MappedSegmentFunction {
+    private:
+        std::shared_ptr<const MappedFile> file;
+        const FrozenRecord *records;
+        size_t count;
+        static double Evaluate(const FrozenRecord &record, double x);
+        static Formula ToFormula(const FrozenRecord &record);
+        EvaluationStatus CalculateIn(size_t i, double x, double &result) const;
+        std::string Rounding(double number) const;
+    public:
+        // Создание объекта
+        explicit MappedSegmentFunction(const std::string &path);
+
+        // Декомпозиция
+        size_t GetSize() const;
+        Segment<double> Get(size_t index) const;
+        size_t FindSegment(double x) const;
+
+        // Операции
+        double CalculateAt(double x) const;
+        EvaluationStatus TryCalculateAt(double x, double &result) const;
+        size_t TryCalculateAt(const double *xs, size_t count, double *results, EvaluationStatus *statuses) const;
+        double operator()(double x) const;
+};
+
+// Создание объекта
+// Записи используются на месте, поэтому нужен little-endian процессор; размер файла обязан точно
+// соответствовать числу сегментов из заголовка
+inline MappedSegmentFunction::MappedSegmentFunction(const std::string &path):
+    file(std::make_shared<const MappedFile>(path)), records(nullptr), count(0) {
+    const uint16_t probe = 1;
+    unsigned char low;
+    std::memcpy(&low, &probe, 1);
+    if (low != 1) throw std::runtime_error("Замороженная таблица читается на месте только на little-endian платформе!");
+    const unsigned char *data = file->GetData();
+    size_t size = file->GetSize();
+    if (size < serializationHeaderSize || std::memcmp(data, serializationMagic, sizeof(serializationMagic)) != 0) {
+        throw std::runtime_error("Неизвестный формат файла!");
+    }
+    uint16_t version = static_cast<uint16_t>(LoadLittle(data+4, 2)), flags = static_cast<uint16_t>(LoadLittle(data+6, 2));
+    if (version == 0 || version > serializationVersion) throw std::runtime_error("Неподдерживаемая версия формата!");
+    if (flags != frozenFlag) throw std::runtime_error("Файл не является замороженной таблицей!");
+    uint64_t segments = LoadLittle(data+8, 8);
+    if (segments != (size-serializationHeaderSize)/frozenRecordSize || (size-serializationHeaderSize) % frozenRecordSize != 0) {
+        throw std::runtime_error("Размер файла не совпадает с числом сегментов!");
+    }
+    records = reinterpret_cast<const FrozenRecord*>(data+serializationHeaderSize);
+    count = static_cast<size_t>(segments);
+}
+
+inline Formula MappedSegmentFunction::ToFormula(const FrozenRecord &record) {
+    Formula formula;
+    formula.kind = record.kind <= static_cast<uint64_t>(FormulaKind::Sine) ? static_cast<FormulaKind>(record.kind) : FormulaKind::Opaque;
+    formula.a = record.a;
+    formula.b = record.b;
+    formula.c = record.c;
+    formula.d = record.d;
+    return formula;
+}
+
+inline double MappedSegmentFunction::Evaluate(const FrozenRecord &record, double x) {
+    return ToFormula(record)(x);
+}
+
+// Декомпозиция
+inline size_t MappedSegmentFunction::GetSize() const {
+    return count;
+}
+
+inline Segment<double> MappedSegmentFunction::Get(size_t index) const {
+    if (index >= count) throw std::out_of_range("Неправильный индекс!");
+    const FrozenRecord &record = records[index];
+    Formula formula = ToFormula(record);
+    Segment<double> segment(record.start, record.end, [formula](double x) {return formula(x);}, formula);
+    segment.startValue = formula(record.start);
+    segment.endValue = formula(record.end);
+    return segment;
+}
+
+// Точки в сообщениях об ошибках округляются так же, как в SegmentFunction
+inline std::string MappedSegmentFunction::Rounding(double number) const {
+    char buffer[20];
+    snprintf(buffer, sizeof(buffer), "%.2f", number);
+    return std::string(buffer);
+}
+
+// Как и в SegmentFunction, общая граница соседних сегментов принадлежит левому
+inline size_t MappedSegmentFunction::FindSegment(double x) const {
+    const FrozenRecord *after = std::upper_bound(records, records+count, x,
+                                                 [](double value, const FrozenRecord &record) {return value < record.start;});
+    if (after == records) return count;
+    size_t i = after-records-1;
+    if (i > 0 && records[i-1].end == x) return i-1;
+    return x <= records[i].end ? i : count;
+}
+
+// Операции
+inline double MappedSegmentFunction::CalculateAt(double x) const {
+    double value;
+    switch (TryCalculateAt(x, value)) {
+        case EvaluationStatus::Discontinuity:
+            throw std::domain_error("Критическая точка x = " + Rounding(x) + " (разрыв)");
+        case EvaluationStatus::Undefined:
+            throw std::out_of_range("Функция не определена в точке x = " + Rounding(x) + "!");
+        default:
+            return value;
+    }
+}
+
+inline EvaluationStatus MappedSegmentFunction::TryCalculateAt(double x, double &result) const {
+    return CalculateIn(FindSegment(x), x, result);
+}
+
+// Значение в точке x сегмента i, найденного FindSegment
+inline EvaluationStatus MappedSegmentFunction::CalculateIn(size_t i, double x, double &result) const {
+    if (i == count) return EvaluationStatus::Undefined;
+    const FrozenRecord &record = records[i];
+    double value = Evaluate(record, x);
+    if (x == record.end && i+1 < count && records[i+1].start == x && !SameValue(value, Evaluate(records[i+1], x))) {
+        return EvaluationStatus::Discontinuity;
+    }
+    result = value;
+    return EvaluationStatus::Defined;
+}
+
+// Для упорядоченных точек сегмент предыдущей точки проверяется раньше двоичного поиска
+inline size_t MappedSegmentFunction::TryCalculateAt(const double *xs, size_t count, double *results, EvaluationStatus *statuses) const {
+    size_t defined = 0, last = this->count;
+    for (size_t i = 0; i < count; i++) {
+        double x = xs[i];
+        if (last < this->count && records[last].start < x && x < records[last].end) {
+            results[i] = Evaluate(records[last], x);
+            statuses[i] = EvaluationStatus::Defined;
+        } else {
+            last = FindSegment(x);
+            statuses[i] = CalculateIn(last, x, results[i]);
+        }
+        if (statuses[i] == EvaluationStatus::Defined) defined++;
+    }
+    return defined;
+}
+
+// Перегрузка операторов
+inline double MappedSegmentFunction::operator()(double x) const {
+    return CalculateAt(x);
+}
+
+#endif // MAPPEDSEGMENTFUNCTION_HPP
@@ -0,0 +1,44 @@
+#ifndef PARALLEL_HPP
+#define PARALLEL_HPP
+
+#include <algorithm>
+#include <exception>
+#include <functional>
+#include <thread>
+#include "sequences/DynamicArray.hpp"
+
+
+// Число потоков для count элементов, если каждому достаётся не меньше grain
+inline size_t ParallelThreads(size_t count, size_t grain) {
+    size_t threads = std::thread::hardware_concurrency();
+    if (threads == 0) threads = 1;
+    if (grain == 0) grain = 1;
+    return std::max<size_t>(1, std::min(threads, count/grain));
+}
+
+// Делит [0, count) на непрерывные куски и вызывает body(chunk, begin, end) для каждого в своём потоке;
+// первое исключение из потоков пробрасывается вызывающему после их завершения
+inline void ParallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t, size_t)> &body) {
+    size_t threads = ParallelThreads(count, grain);
+    if (threads == 1) {
+        if (count > 0) body(0, 0, count);
+        return;
+    }
+    DynamicArray<std::thread> workers(threads-1);
+    DynamicArray<std::exception_ptr> errors(threads);
+    auto run = [&body, &errors, count, threads](size_t chunk) {
+        try {
+            body(chunk, count*chunk/threads, count*(chunk+1)/threads);
+        } catch (...) {
+            errors[chunk] = std::current_exception();
+        }
+    };
+    for (size_t chunk = 1; chunk < threads; chunk++) workers[chunk-1] = std::thread(run, chunk);
+    run(0);
+    for (size_t i = 0; i < threads-1; i++) workers[i].join();
+    for (size_t chunk = 0; chunk < threads; chunk++) {
+        if (errors[chunk]) std::rethrow_exception(errors[chunk]);
+    }
+}
+
+#endif // PARALLEL_HPP
@@ -0,0 +1,65 @@
+#ifndef ROOTS_HPP
+#define ROOTS_HPP
+
+#include <cmath>
+#include <limits>
+#include <utility>
+
+
+// Метод Брента: корень g на [a, b] при известных ga = g(a), gb = g(b) разных знаков.
+// Сочетает обратную квадратичную интерполяцию и секущие с гарантированным делением пополам
+template <typename F>
+double Brent(const F &g, double a, double b, double ga, double gb, double tolerance = 1e-12, int iterations = 100) {
+    if (ga == 0) return a;
+    if (gb == 0) return b;
+    double c = b, gc = gb, d = b-a, e = d;
+    for (int i = 0; i < iterations; i++) {
+        if ((gb > 0) == (gc > 0)) {
+            c = a;
+            gc = ga;
+            d = b-a;
+            e = d;
+        }
+        if (std::abs(gc) < std::abs(gb)) {
+            a = b;
+            b = c;
+            c = a;
+            ga = gb;
+            gb = gc;
+            gc = ga;
+        }
+        double precision = 2*std::numeric_limits<double>::epsilon()*std::abs(b)+tolerance/2;
+        double middle = (c-b)/2;
+        if (std::abs(middle) <= precision || gb == 0) return b;
+        if (std::abs(e) >= precision && std::abs(ga) > std::abs(gb)) {
+            double s = gb/ga, p, q;
+            if (a == c) {
+                p = 2*middle*s;
+                q = 1-s;
+            } else {
+                double r = gb/gc, t = ga/gc;
+                p = s*(2*middle*t*(t-r)-(b-a)*(r-1));
+                q = (t-1)*(r-1)*(s-1);
+            }
+            if (p > 0) q = -q;
+            else p = -p;
+            if (2*p < std::min(3*middle*q-std::abs(precision*q), std::abs(e*q))) {
+                e = d;
+                d = p/q;
+            } else {
+                d = middle;
+                e = d;
+            }
+        } else {
+            d = middle;
+            e = d;
+        }
+        a = b;
+        ga = gb;
+        b += std::abs(d) > precision ? d : (middle > 0 ? precision : -precision);
+        gb = g(b);
+    }
+    return b;
+}
+
+#endif // ROOTS_HPP
@@ -1,30 +1,148 @@
 #ifndef SEGMENTFUNCTION_HPP
 #define SEGMENTFUNCTION_HPP
 
+#include <algorithm>
+#include <atomic>
 #include <cmath>
 #include <functional>
+#include <limits>
+#include <mutex>
+#include <type_traits>
 #include "ICollectionSegment.hpp"
 #include "EnumeratorSegment.hpp"
+#include "SegmentIndex.hpp"
+#include "Statistics.hpp"
+#include "EvaluationCache.hpp"
+#include "Formula.hpp"
+#include "Parallel.hpp"
+#include "Integration.hpp"
+#include "Roots.hpp"
+#include "SparseTable.hpp"
+#include "Chebyshev.hpp"
+#include "SegmentNode.hpp"
+#include "Expression.hpp"
+#include "Serialization.hpp"
+#include "Csv.hpp"
 #include "sequences/ArraySequence.hpp"
 #include "sequences/ListSequence.hpp"
 using namespace std;
 
 
+// Результат вычисления без исключений
+enum class EvaluationStatus {Defined, Discontinuity, Undefined};
+
+// Стык сегмента со следующим: нет следующего, разрыв области, скачок, непрерывно
+enum class Junction {None, Gap, Jump, Continuous};
+
+// Сводные счётчики по сегментам и стыкам для IsMonotonic / IsContinuous
+struct SegmentTotals {
+    size_t pending;
+    size_t rises;
+    size_t falls;
+    size_t irregular;
+    size_t gaps;
+    size_t jumps;
+    SegmentTotals(): pending(0), rises(0), falls(0), irregular(0), gaps(0), jumps(0) {}
+};
+
+// Сводка по всей функции из AnalyzeAll
+template <typename T>
+struct FunctionAnalysis {
+    T min;
+    T max;
+    bool monotonic;
+    bool continuous;
+    FunctionAnalysis(): min(), max(), monotonic(false), continuous(false) {}
+};
+
+template <typename T>
+bool SameValue(const T &a, const T &b) {
+    return a == b;
+}
+
+inline bool SameValue(double a, double b) {
+    return a == b || abs(a-b) <= 1e-12;
+}
+
+// Каждый новый сегмент получает уникальный id, копии и обрезки сохраняют его
+inline size_t NextSegmentId() {
+    static atomic<size_t> counter(0);
+    return ++counter;
+}
+
 template <typename T>
 class Segment {
     public:
         double start;
         double end;
         function<T(double)> func;
-        Segment(): start(0), end(0), func(nullptr) {}
-        Segment(double s, double e, function<T(double)> f): start(s), end(e), func(f) {}
+        size_t id;
+        T startValue;
+        T endValue;
+        Junction junction;
+        Monotony monotony;
+        T minValue;
+        T maxValue;
+        Formula formula;
+        IntegrationResult integral;
+        bool integrated;
+        shared_ptr<const SegmentNode> node;
+        Segment(): start(0), end(0), func(nullptr), id(0), startValue(), endValue(), junction(Junction::None),
+            monotony(Monotony::Unknown), minValue(), maxValue(), formula(), integral(), integrated(false), node() {}
+        Segment(double s, double e, function<T(double)> f, const Formula &formula = Formula()):
+            start(s), end(e), func(f), id(NextSegmentId()), startValue(), endValue(), junction(Junction::None),
+            monotony(Monotony::Unknown), minValue(), maxValue(), formula(formula), integral(), integrated(false), node() {}
 };
 
+// Константные методы можно вызывать из нескольких потоков одновременно: ленивые индексы, анализ монотонности
+// и префиксные интегралы достраиваются под lazyLock. Изменяющие методы (Define, Assign, CalculateAt с кэшем)
+// требуют, чтобы с объектом в это время никто больше не работал
 template <typename T>
 class SegmentFunction: public ICollectionSegment<Segment<T>>, public IEnumerableSegment<Segment<T>> {
     protected:
         friend class Segment<T>;
+        template <typename> friend class SegmentFunction;
         Sequence<Segment<T>> *segments;
+        mutable SegmentIndex segmentIndex;
+        mutable SparseTable<T> extremaTable;
+        mutable atomic<size_t> cursor;
+        mutable atomic<size_t> lookupHits;
+        mutable atomic<size_t> lookupMisses;
+        mutable mutex lazyLock;
+        EvaluationCache<T> *cache;
+        mutable PrefixIntegrals *prefix;
+        mutable SegmentTotals totals;
+        size_t monotonicSamples;
+        bool autoCompact;
+        double sliverWidth;
+        CompactionStatistics compaction;
+        static const size_t parallelGrain = 256;
+        bool Owns(size_t i, double x) const;
+        size_t LowerSegment(double x) const;
+        size_t UpperSegment(double x) const;
+        void Detach(size_t from, size_t to);
+        void Attach(size_t from, size_t to, double start, double end);
+        void Count(size_t i, bool add) const;
+        Monotony Inspect(Segment<T> &segment) const;
+        EvaluationStatus EvaluateSegment(size_t i, double x, T &result) const;
+        void AnalyzePending(bool stopOnViolation) const;
+        void Analyze(bool stopOnViolation) const;
+        void DefineSegment(double start, double end, function<T(double)> func, const Formula &formula,
+                           shared_ptr<const SegmentNode> node = nullptr);
+        static IntegrationResult IntegrateSegment(const Segment<T> &segment, double left, double right, double tolerance);
+        void UpdatePrefix() const;
+        bool SolveBetween(const Segment<T> &segment, double y, double left, double right, T leftValue, T rightValue, double &x) const;
+        template <typename Visitor>
+        bool VisitRoots(const Segment<T> &segment, double y, const Visitor &visit) const;
+        EvaluationStatus SolveIn(double y, double &x, bool monotonic) const;
+        void PartialExtrema(const Segment<T> &segment, double left, double right, T &low, T &high) const;
+        void RangeExtrema(double a, double b, T &low, T &high) const;
+        void Assign(Segment<T> *items, size_t count, bool keepAnalysis);
+        void Replace(Sequence<Segment<T>> *table);
+        static bool Mergeable(const Segment<T> &left, const Segment<T> &right);
+        static size_t Fold(Segment<T> *items, size_t count, double width, CompactionStatistics &statistics);
+        void CompactNear(size_t from, size_t to);
+        static Segment<T> CombineSegments(const Segment<T> &left, const Segment<T> &right, double start, double end, Operation operation);
     public:
         // Конструкторы
         SegmentFunction();
@@ -35,14 +153,45 @@ class SegmentFunction: public ICollectionSegment<Segment<T>>, public IEnumerable
         // Вспомогательные функции (+ ICollection)
         size_t GetSize() const override;
         Segment<T> Get(size_t index) const override;
-        string Rounding(double number);
+        string Rounding(double number) const;
         void Clear();
+        void Assign(Segment<T> *items, size_t count);
+        size_t FindSegment(double x) const;
+        bool IsUniform() const;
+        HitStatistics GetLookupStatistics() const;
+        void ResetLookupStatistics();
+        void EnableCache(size_t capacity);
+        void DisableCache();
+        HitStatistics GetCacheStatistics() const;
+        void EnableIntegralIndex(double tolerance = 1e-10);
+        void DisableIntegralIndex();
+        size_t GetMonotonicSamples() const;
+        void SetMonotonicSamples(size_t samples);
+        void EnableAutoCompact(double width = 1e-12);
+        void DisableAutoCompact();
+        CompactionStatistics GetCompactionStatistics() const;
 
         // Базовые функции
         void Define(double start, double end, function<T(double)> func);
+        void Define(double start, double end, const Formula &formula);
+        void Define(double start, double end, const Expression &expression);
         bool IsMonotonic() const;
         bool IsContinuous() const;
+        FunctionAnalysis<T> AnalyzeAll() const;
+        IntegrationResult Integrate(double a, double b, double tolerance = 1e-10) const;
         T CalculateAt(double x);
+        EvaluationStatus TryCalculateAt(double x, T &result);
+        size_t TryCalculateAt(const double *xs, size_t count, T *results, EvaluationStatus *statuses);
+        double Solve(double y) const;
+        EvaluationStatus TrySolve(double y, double &x) const;
+        size_t TrySolve(const double *ys, size_t count, double *xs, EvaluationStatus *statuses) const;
+        Sequence<double>* SolveAll(double y) const;
+        T RangeMin(double a, double b) const;
+        T RangeMax(double a, double b) const;
+        SegmentFunction<T> Compile(double tolerance, CompilationReport *report = nullptr) const;
+        CompactionStatistics Compact(double width = 1e-12);
+        SegmentFunction<T> Combine(const SegmentFunction<T> &other, Operation operation) const;
+        SegmentFunction<T> Compose(const SegmentFunction<double> &inner) const;
 
         // Перегрузка операторов
         T operator()(double x);
@@ -58,6 +207,9 @@ class SegmentFunction: public ICollectionSegment<Segment<T>>, public IEnumerable
         SegmentFunction<pair<T, U>> Zip(SegmentFunction<U> &other);
         template <typename U, typename V>
         static pair<SegmentFunction<U>, SegmentFunction<V>> Unzip(SegmentFunction<pair<U, V>> &other);
+        void Save(ostream &out, bool frozen = false) const;
+        static SegmentFunction<T> Load(istream &in);
+        static SegmentFunction<T> Import(istream &in, bool parallel = false);
 
         // IEnumerator + IEnumerable
         class IteratorSegment: public IEnumeratorSegment<Segment<T>> {
@@ -99,26 +251,55 @@ class SegmentFunction: public ICollectionSegment<Segment<T>>, public IEnumerable
 template <typename T>
 SegmentFunction<T>::SegmentFunction() {
     segments = new ArraySequence<Segment<T>>();
+    cursor = 0;
+    lookupHits = 0;
+    lookupMisses = 0;
+    cache = nullptr;
+    prefix = nullptr;
+    totals = SegmentTotals();
+    monotonicSamples = 100;
+    autoCompact = false;
+    sliverWidth = 0;
 }
 
 template <typename T>
 SegmentFunction<T>::~SegmentFunction() {
     delete segments;
+    delete cache;
+    delete prefix;
 }
 
 template <typename T>
 SegmentFunction<T>::SegmentFunction(const SegmentFunction<T> &other) {
     segments = new ArraySequence<Segment<T>>();
-    for (size_t i = 0; i < other.GetSize(); i++) {
-        Segment<T> segment = other.Get(i);
-        segments->Append(segment);
-    }
+    cursor = 0;
+    lookupHits = 0;
+    lookupMisses = 0;
+    cache = other.cache ? new EvaluationCache<T>(other.cache->GetCapacity()) : nullptr;
+    prefix = other.prefix ? new PrefixIntegrals(other.prefix->tolerance) : nullptr;
+    monotonicSamples = other.monotonicSamples;
+    autoCompact = other.autoCompact;
+    sliverWidth = other.sliverWidth;
+    lock_guard<mutex> lock(other.lazyLock);
+    totals = other.totals;
+    for (size_t i = 0; i < other.GetSize(); i++) segments->Append((*other.segments)[i]);
 }
 
 template <typename T>
 SegmentFunction<T>::SegmentFunction(SegmentFunction<T> &&other) {
     segments = other.segments;
+    cursor = 0;
+    lookupHits = 0;
+    lookupMisses = 0;
+    cache = other.cache;
+    prefix = other.prefix;
+    totals = other.totals;
+    monotonicSamples = other.monotonicSamples;
+    autoCompact = other.autoCompact;
+    sliverWidth = other.sliverWidth;
     other.segments = nullptr;
+    other.cache = nullptr;
+    other.prefix = nullptr;
 }
 
 // Вспомогательные функции
@@ -132,11 +313,12 @@ Segment<T> SegmentFunction<T>::Get(size_t index) const {
     if (index >= GetSize()) {
         throw out_of_range("Неправильный индекс!");
     }
+    lock_guard<mutex> lock(lazyLock);
     return (*segments)[index];
 }
 
 template <typename T>
-string SegmentFunction<T>::Rounding(double number) {
+string SegmentFunction<T>::Rounding(double number) const {
     char buffer[20];
     snprintf(buffer, sizeof(buffer), "%.2f", number);
     return string(buffer);
@@ -145,12 +327,313 @@ string SegmentFunction<T>::Rounding(double number) {
 template <typename T>
 void SegmentFunction<T>::Clear() {
     while (GetSize() > 0) segments->Remove(0);
+    segmentIndex.Invalidate();
+    extremaTable.Invalidate();
+    if (cache) cache->Clear();
+    if (prefix) prefix->valid = 0;
+    totals = SegmentTotals();
+}
+
+template <typename T>
+bool SegmentFunction<T>::Owns(size_t i, double x) const {
+    if (i >= segments->GetLength()) return false;
+    const Segment<T> &segment = (*segments)[i];
+    if (x < segment.start || segment.end < x) return false;
+    return i == 0 || (*segments)[i-1].end != x;
+}
+
+// Курсор - только подсказка: потоки, читающие функцию одновременно, могут перетирать его друг у друга,
+// а счётчики попаданий при этом становятся приблизительными, но результат поиска от этого не зависит
+template <typename T>
+size_t SegmentFunction<T>::FindSegment(double x) const {
+    size_t hint = cursor.load(memory_order_relaxed);
+    if (!Owns(hint, x)) {
+        if (Owns(hint+1, x)) hint++;
+        else if (hint > 0 && Owns(hint-1, x)) hint--;
+    }
+    if (Owns(hint, x)) {
+        lookupHits.store(lookupHits.load(memory_order_relaxed)+1, memory_order_relaxed);
+        cursor.store(hint, memory_order_relaxed);
+        return hint;
+    }
+    lookupMisses.store(lookupMisses.load(memory_order_relaxed)+1, memory_order_relaxed);
+    if (!segmentIndex.IsBuilt()) {
+        lock_guard<mutex> lock(lazyLock);
+        if (!segmentIndex.IsBuilt()) segmentIndex.Build(*segments);
+    }
+    size_t i = segmentIndex.Find(x);
+    if (i < segments->GetLength()) cursor.store(i, memory_order_relaxed);
+    return i;
+}
+
+template <typename T>
+bool SegmentFunction<T>::IsUniform() const {
+    if (!segmentIndex.IsBuilt()) {
+        lock_guard<mutex> lock(lazyLock);
+        if (!segmentIndex.IsBuilt()) segmentIndex.Build(*segments);
+    }
+    return segmentIndex.IsUniform();
+}
+
+template <typename T>
+HitStatistics SegmentFunction<T>::GetLookupStatistics() const {
+    HitStatistics statistics;
+    statistics.hits = lookupHits.load(memory_order_relaxed);
+    statistics.misses = lookupMisses.load(memory_order_relaxed);
+    return statistics;
+}
+
+template <typename T>
+void SegmentFunction<T>::ResetLookupStatistics() {
+    lookupHits = 0;
+    lookupMisses = 0;
+}
+
+template <typename T>
+void SegmentFunction<T>::EnableCache(size_t capacity) {
+    EvaluationCache<T> *newCache = new EvaluationCache<T>(capacity);
+    delete cache;
+    cache = newCache;
+}
+
+template <typename T>
+void SegmentFunction<T>::DisableCache() {
+    delete cache;
+    cache = nullptr;
+}
+
+template <typename T>
+HitStatistics SegmentFunction<T>::GetCacheStatistics() const {
+    return cache ? cache->GetStatistics() : HitStatistics();
+}
+
+template <typename T>
+void SegmentFunction<T>::EnableIntegralIndex(double tolerance) {
+    if (!(tolerance > 0)) throw invalid_argument("Неправильный допуск!");
+    delete prefix;
+    prefix = new PrefixIntegrals(tolerance);
+    for (size_t i = 0; i < segments->GetLength(); i++) (*segments)[i].integrated = false;
+}
+
+template <typename T>
+void SegmentFunction<T>::DisableIntegralIndex() {
+    delete prefix;
+    prefix = nullptr;
+}
+
+template <typename T>
+size_t SegmentFunction<T>::GetMonotonicSamples() const {
+    return monotonicSamples;
+}
+
+// Сегменты без формулы, проанализированные по выборке, будут пересчитаны с новым числом шагов
+template <typename T>
+void SegmentFunction<T>::SetMonotonicSamples(size_t samples) {
+    if (samples == 0) throw invalid_argument("Неправильное число шагов!");
+    monotonicSamples = samples;
+    extremaTable.Invalidate();
+    for (size_t i = 0; i < segments->GetLength(); i++) {
+        Segment<T> &segment = (*segments)[i];
+        if (segment.formula.IsOpaque() && segment.monotony != Monotony::Unknown) {
+            Count(i, false);
+            segment.monotony = Monotony::Unknown;
+            Count(i, true);
+        }
+    }
+}
+
+// Соседние сегменты с одной функцией сливаются, обрезки не шире width убираются сразу после каждого Define
+template <typename T>
+void SegmentFunction<T>::EnableAutoCompact(double width) {
+    if (!(width >= 0)) throw invalid_argument("Неправильный допуск!");
+    autoCompact = true;
+    sliverWidth = width;
+}
+
+template <typename T>
+void SegmentFunction<T>::DisableAutoCompact() {
+    autoCompact = false;
+}
+
+template <typename T>
+CompactionStatistics SegmentFunction<T>::GetCompactionStatistics() const {
+    return compaction;
+}
+
+template <typename T>
+size_t SegmentFunction<T>::LowerSegment(double x) const {
+    size_t left = 0, right = segments->GetLength();
+    while (left < right) {
+        size_t middle = left+(right-left)/2;
+        if ((*segments)[middle].end < x) left = middle+1;
+        else right = middle;
+    }
+    return left;
+}
+
+template <typename T>
+size_t SegmentFunction<T>::UpperSegment(double x) const {
+    size_t left = 0, right = segments->GetLength();
+    while (left < right) {
+        size_t middle = left+(right-left)/2;
+        if ((*segments)[middle].start <= x) left = middle+1;
+        else right = middle;
+    }
+    return left;
+}
+
+// Добавляет (или снимает) вклад сегмента i и его стыка со следующим в сводные счётчики.
+// Направление скачка учитывается только для арифметического T: Define не требует от значений порядка
+template <typename T>
+void SegmentFunction<T>::Count(size_t i, bool add) const {
+    auto update = [add](size_t &counter) {
+        if (add) counter++;
+        else counter--;
+    };
+    const Segment<T> &segment = (*segments)[i];
+    switch (segment.monotony) {
+        case Monotony::Unknown: update(totals.pending); break;
+        case Monotony::Increasing: update(totals.rises); break;
+        case Monotony::Decreasing: update(totals.falls); break;
+        case Monotony::None: update(totals.irregular); break;
+        case Monotony::Constant: break;
+    }
+    if (segment.junction == Junction::Gap) {
+        update(totals.gaps);
+    } else if (segment.junction == Junction::Jump) {
+        update(totals.jumps);
+        if constexpr (is_arithmetic_v<T>) update(segment.endValue < (*segments)[i+1].startValue ? totals.rises : totals.falls);
+    }
+}
+
+// Снимает вклад сегментов [from, to) перед их изменением
+template <typename T>
+void SegmentFunction<T>::Detach(size_t from, size_t to) {
+    for (size_t i = from; i < to; i++) Count(i, false);
+}
+
+// Пересчитывает значения на концах затронутых отрезком [start, end] сегментов и их стыки
+template <typename T>
+void SegmentFunction<T>::Attach(size_t from, size_t to, double start, double end) {
+    for (size_t i = from; i < to; i++) {
+        Segment<T> &segment = (*segments)[i];
+        if (start <= segment.end && segment.start <= end) {
+            segment.startValue = segment.func(segment.start);
+            segment.endValue = segment.func(segment.end);
+        }
+    }
+    for (size_t i = from; i < to; i++) {
+        Segment<T> &segment = (*segments)[i];
+        if (i+1 == segments->GetLength()) {
+            segment.junction = Junction::None;
+        } else {
+            const Segment<T> &next = (*segments)[i+1];
+            if (segment.end != next.start) segment.junction = Junction::Gap;
+            else if (SameValue(segment.endValue, next.startValue)) segment.junction = Junction::Continuous;
+            else segment.junction = Junction::Jump;
+        }
+        Count(i, true);
+    }
+}
+
+// Монотонность сегмента и его минимум/максимум: аналитически по формуле или по выборке из monotonicSamples шагов.
+// Меняет только minValue/maxValue этого сегмента, поэтому безопасна для разных сегментов в разных потоках
+template <typename T>
+Monotony SegmentFunction<T>::Inspect(Segment<T> &segment) const {
+    Monotony monotony = segment.formula.MonotonyOn(segment.start, segment.end);
+    double low, high;
+    if (segment.formula.Extrema(segment.start, segment.end, low, high)) {
+        segment.minValue = T(low);
+        segment.maxValue = T(high);
+        return monotony;
+    }
+    bool increase = false, decrease = false, irregular = false;
+    T previous = segment.startValue;
+    segment.minValue = previous;
+    segment.maxValue = previous;
+    for (size_t k = 1; k <= monotonicSamples; k++) {
+        T current = k == monotonicSamples ? segment.endValue : segment.func(segment.start+(segment.end-segment.start)*k/monotonicSamples);
+        if (SameValue(previous, current)) {}
+        else if (previous < current) increase = true;
+        else if (current < previous) decrease = true;
+        else irregular = true;
+        if (current < segment.minValue) segment.minValue = current;
+        if (segment.maxValue < current) segment.maxValue = current;
+        previous = current;
+    }
+    if (monotony == Monotony::None || irregular || (increase && decrease)) return Monotony::None;
+    if (increase) return Monotony::Increasing;
+    if (decrease) return Monotony::Decreasing;
+    return Monotony::Constant;
+}
+
+// Анализирует сегменты с неизвестной монотонностью кусками в нескольких потоках;
+// при stopOnViolation потоки останавливаются, как только монотонность всей функции нарушена
+template <typename T>
+void SegmentFunction<T>::AnalyzePending(bool stopOnViolation) const {
+    lock_guard<mutex> lock(lazyLock);
+    Analyze(stopOnViolation);
+}
+
+// Сам анализ; вызывается под lazyLock
+template <typename T>
+void SegmentFunction<T>::Analyze(bool stopOnViolation) const {
+    if (totals.pending == 0) return;
+    DynamicArray<size_t> pending(totals.pending);
+    size_t count = 0;
+    for (size_t i = 0; i < segments->GetLength(); i++) {
+        if ((*segments)[i].monotony == Monotony::Unknown) pending[count++] = i;
+    }
+    DynamicArray<Monotony> results(count);
+    for (size_t k = 0; k < count; k++) results[k] = Monotony::Unknown;
+    atomic<bool> stop(false), rise(totals.rises > 0), fall(totals.falls > 0);
+    ParallelFor(count, parallelGrain, [&](size_t, size_t begin, size_t end) {
+        for (size_t k = begin; k < end && !stop.load(memory_order_relaxed); k++) {
+            Monotony monotony = Inspect((*segments)[pending[k]]);
+            results[k] = monotony;
+            if (!stopOnViolation) continue;
+            if (monotony == Monotony::Increasing) rise = true;
+            else if (monotony == Monotony::Decreasing) fall = true;
+            if (monotony == Monotony::None || (rise && fall)) stop = true;
+        }
+    });
+    for (size_t k = 0; k < count; k++) {
+        if (results[k] == Monotony::Unknown) continue;
+        Count(pending[k], false);
+        (*segments)[pending[k]].monotony = results[k];
+        Count(pending[k], true);
+    }
 }
 
 // Базовые функции
 template <typename T>
 void SegmentFunction<T>::Define(double start, double end, function<T(double)> func) {
+    DefineSegment(start, end, func, Formula());
+}
+
+template <typename T>
+void SegmentFunction<T>::Define(double start, double end, const Formula &formula) {
+    if (formula.IsOpaque()) throw invalid_argument("Неизвестный вид функции!");
+    DefineSegment(start, end, [formula](double x) {return T(formula(x));}, formula);
+}
+
+// Выражение разобрано заранее; узел сегмента позволяет пакетному TryCalculateAt считать его блоками
+template <typename T>
+void SegmentFunction<T>::Define(double start, double end, const Expression &expression) {
+    DefineSegment(start, end, [expression](double x) {return T(expression(x));}, Formula(), make_shared<const ExpressionNode>(expression));
+}
+
+template <typename T>
+void SegmentFunction<T>::DefineSegment(double start, double end, function<T(double)> func, const Formula &formula,
+                                       shared_ptr<const SegmentNode> node) {
     if (start >= end) throw invalid_argument("Неправильные аргументы!");
+    segmentIndex.Invalidate();
+    extremaTable.Invalidate();
+    if (cache) cache->Invalidate(start, end);
+    size_t from = LowerSegment(start);
+    if (from > 0) from--;
+    if (prefix && prefix->valid > from) prefix->valid = from;
+    Detach(from, UpperSegment(end));
     bool flag = true;
     size_t length = segments->GetLength(), counter = 0;
     for (size_t i = 0; i < length; i++) {
@@ -160,29 +643,40 @@ void SegmentFunction<T>::Define(double start, double end, function<T(double)> fu
             counter++;
         } else if (start <= segment.start && segment.start < end) {
             segment.start = end;
-            Segment<T> new_segment(start, end, func);
+            segment.monotony = Monotony::Unknown;
+            segment.integrated = false;
+            Segment<T> new_segment(start, end, func, formula);
+            new_segment.node = node;
             segments->PutAt(new_segment, i-counter);
             flag = false;
             break;
         } else if (start < segment.end && segment.end <= end) {
             segment.end = start;
+            segment.monotony = Monotony::Unknown;
+            segment.integrated = false;
             if (i != length-1) {
                 if (end <= (*segments)[i-counter+1].start) {
-                    Segment<T> new_segment(start, end, func);
+                    Segment<T> new_segment(start, end, func, formula);
+                    new_segment.node = node;
                     segments->PutAt(new_segment, i-counter+1);
                     flag = false;
                     break;
                 }
             } else {
-                Segment<T> new_segment(start, end, func);
+                Segment<T> new_segment(start, end, func, formula);
+                new_segment.node = node;
                 segments->Append(new_segment);
                 flag = false;
                 break;
             }
         } else if (segment.start < start && end < segment.end) {
-            Segment<T> new_segment_1(start, end, func);
-            Segment<T> new_segment_2(segment.start, start, segment.func);
+            Segment<T> new_segment_1(start, end, func, formula);
+            new_segment_1.node = node;
+            Segment<T> new_segment_2(segment.start, start, segment.func, segment.formula);
+            new_segment_2.node = segment.node;
             segment.start = end;
+            segment.monotony = Monotony::Unknown;
+            segment.integrated = false;
             segments->PutAt(new_segment_1, i-counter);
             segments->PutAt(new_segment_2, i-counter);
             flag = false;
@@ -190,69 +684,737 @@ void SegmentFunction<T>::Define(double start, double end, function<T(double)> fu
         }
     }
     if (flag) {
-        Segment<T> segment(start, end, func);
-        segments->Append(segment);
+        Segment<T> segment(start, end, func, formula);
+        segment.node = node;
+        size_t position = 0;
+        while (position < segments->GetLength() && (*segments)[position].start < end) position++;
+        if (position < segments->GetLength()) segments->PutAt(segment, position);
+        else segments->Append(segment);
     }
+    Attach(from, UpperSegment(end), start, end);
+    if (autoCompact) CompactNear(from, UpperSegment(end)+1);
 }
 
 template <typename T>
 bool SegmentFunction<T>::IsMonotonic() const {
-    if (segments->GetLength() == 0) return false;
-    double dx, prev_x = (*segments)[0].start;
-    T start, end, dy, prev_y = (*segments)[0].func(prev_x);
-    bool increase = false, decrease = false;
-    for (size_t i = 0; i < segments->GetLength(); i++) {
-        Segment<T> &segment = (*segments)[i];
-        start = segment.func(segment.start);
-        end = segment.func(segment.end);
-        if (abs(prev_x-segment.start) < 1e-6) {
-            if (abs(prev_y-start) < 1e-6 && abs(end-start) < 1e-6) {}
-            else if (prev_y <= start && start <= end && !decrease) increase = true;
-            else if (prev_y >= start && start >= end && !increase) decrease = true;
-            else return false;
-        } else return false;
-        dx = (segment.end-segment.start)/100.0;
-        for (double x = segment.start; x < segment.end; x += dx) {
-            dy = segment.func(x+dx)-segment.func(x);
-            if ((dy < 0 && increase) || (dy > 0 && decrease)) return false;
-        }
-        prev_x = segment.end;
-        prev_y = end;
+    lock_guard<mutex> lock(lazyLock);
+    if (segments->GetLength() == 0 || totals.gaps > 0) return false;
+    if (totals.irregular > 0 || (totals.rises > 0 && totals.falls > 0)) return false;
+    Analyze(true);
+    return totals.irregular == 0 && (totals.rises == 0 || totals.falls == 0);
+}
+
+template <typename T>
+bool SegmentFunction<T>::IsContinuous() const {
+    lock_guard<mutex> lock(lazyLock);
+    return segments->GetLength() > 0 && totals.gaps == 0 && totals.jumps == 0;
+}
+
+// Минимум, максимум (по выборке внутри немонотонных сегментов), монотонность и непрерывность за один проход
+template <typename T>
+FunctionAnalysis<T> SegmentFunction<T>::AnalyzeAll() const {
+    size_t n = segments->GetLength();
+    if (n == 0) throw out_of_range("Функция не определена!");
+    AnalyzePending(false);
+    size_t chunks = ParallelThreads(n, parallelGrain);
+    DynamicArray<T> minimums(chunks), maximums(chunks);
+    ParallelFor(n, parallelGrain, [&](size_t chunk, size_t begin, size_t end) {
+        minimums[chunk] = (*segments)[begin].minValue;
+        maximums[chunk] = (*segments)[begin].maxValue;
+        for (size_t i = begin+1; i < end; i++) {
+            const Segment<T> &segment = (*segments)[i];
+            if (segment.minValue < minimums[chunk]) minimums[chunk] = segment.minValue;
+            if (maximums[chunk] < segment.maxValue) maximums[chunk] = segment.maxValue;
+        }
+    });
+    FunctionAnalysis<T> result;
+    result.min = minimums[0];
+    result.max = maximums[0];
+    for (size_t chunk = 1; chunk < chunks; chunk++) {
+        if (minimums[chunk] < result.min) result.min = minimums[chunk];
+        if (result.max < maximums[chunk]) result.max = maximums[chunk];
+    }
+    result.monotonic = IsMonotonic();
+    result.continuous = IsContinuous();
+    return result;
+}
+
+template <typename T>
+IntegrationResult SegmentFunction<T>::IntegrateSegment(const Segment<T> &segment, double left, double right, double tolerance) {
+    double value;
+    if (segment.formula.Integral(left, right, value)) {
+        return IntegrationResult(value, 4*numeric_limits<double>::epsilon()*abs(value));
+    }
+    return AdaptiveGaussKronrod(segment.func, left, right, tolerance);
+}
+
+// Досчитывает префиксные суммы с первого изменённого сегмента; интегралы целых сегментов
+// кэшируются в самих сегментах, поэтому заново интегрируются только затронутые Define
+template <typename T>
+void SegmentFunction<T>::UpdatePrefix() const {
+    size_t n = segments->GetLength();
+    if (prefix->sums.GetSize() != n+1) {
+        prefix->sums.Resize(n+1);
+        prefix->gaps.Resize(n+1);
+    }
+    if (prefix->valid == n+1) return;
+    size_t first = prefix->valid == 0 ? 0 : prefix->valid-1;
+    ParallelFor(n-first, parallelGrain, [&](size_t, size_t begin, size_t end) {
+        for (size_t i = first+begin; i < first+end; i++) {
+            Segment<T> &segment = (*segments)[i];
+            if (segment.integrated) continue;
+            segment.integral = IntegrateSegment(segment, segment.start, segment.end, prefix->tolerance*(segment.end-segment.start));
+            segment.integrated = true;
+        }
+    });
+    if (prefix->valid == 0) {
+        prefix->sums[0] = IntegrationResult();
+        prefix->gaps[0] = 0;
+        prefix->valid = 1;
+    }
+    for (size_t k = prefix->valid; k <= n; k++) {
+        const Segment<T> &segment = (*segments)[k-1];
+        prefix->sums[k] = prefix->sums[k-1];
+        prefix->sums[k] += segment.integral;
+        prefix->gaps[k] = prefix->gaps[k-1]+(segment.junction == Junction::Gap ? 1 : 0);
+    }
+    prefix->valid = n+1;
+}
+
+// Определённый интеграл по [a, b]: первообразная для сегментов с формулой, адаптивный G7-K15 для остальных.
+// С индексом (EnableIntegralIndex) целые сегменты берутся из префиксных сумм, интегрируются только крайние куски;
+// без индекса допуск делится между сегментами пропорционально длине, сегменты обрабатываются параллельно
+template <typename T>
+IntegrationResult SegmentFunction<T>::Integrate(double a, double b, double tolerance) const {
+    if (a > b || !(tolerance > 0)) throw invalid_argument("Неправильные аргументы!");
+    size_t from = LowerSegment(a), to = UpperSegment(b);
+    if (from < to && (*segments)[from].end == a && a < b) from++;
+    if (from >= to || a < (*segments)[from].start || (*segments)[to-1].end < b) {
+        throw out_of_range("Функция не определена на всём отрезке интегрирования!");
+    }
+    if (prefix) {
+        lock_guard<mutex> lock(lazyLock);
+        UpdatePrefix();
+        if (prefix->gaps[to-1] != prefix->gaps[from]) throw out_of_range("Функция не определена на всём отрезке интегрирования!");
+        if (a == b) return IntegrationResult();
+        const Segment<T> &first = (*segments)[from], &last = (*segments)[to-1];
+        if (from+1 == to) {
+            return a == first.start && b == first.end ? first.integral : IntegrateSegment(first, a, b, tolerance);
+        }
+        IntegrationResult result = a == first.start ? first.integral : IntegrateSegment(first, a, first.end, tolerance/2);
+        result += b == last.end ? last.integral : IntegrateSegment(last, last.start, b, tolerance/2);
+        const IntegrationResult &low = prefix->sums[from+1], &high = prefix->sums[to-1];
+        result += IntegrationResult(high.value-low.value,
+            high.error-low.error+numeric_limits<double>::epsilon()*(abs(high.value)+abs(low.value)));
+        return result;
+    }
+    for (size_t i = from; i+1 < to; i++) {
+        if ((*segments)[i].junction == Junction::Gap) throw out_of_range("Функция не определена на всём отрезке интегрирования!");
+    }
+    if (a == b) return IntegrationResult();
+    size_t chunks = ParallelThreads(to-from, parallelGrain);
+    DynamicArray<IntegrationResult> sums(chunks);
+    ParallelFor(to-from, parallelGrain, [&](size_t chunk, size_t begin, size_t end) {
+        IntegrationResult sum;
+        for (size_t i = from+begin; i < from+end; i++) {
+            const Segment<T> &segment = (*segments)[i];
+            double left = max(a, segment.start), right = min(b, segment.end);
+            sum += IntegrateSegment(segment, left, right, tolerance*(right-left)/(b-a));
+        }
+        sums[chunk] = sum;
+    });
+    IntegrationResult result;
+    for (size_t chunk = 0; chunk < chunks; chunk++) result += sums[chunk];
+    return result;
+}
+
+template <typename T>
+T SegmentFunction<T>::CalculateAt(double x) {
+    T value;
+    switch (TryCalculateAt(x, value)) {
+        case EvaluationStatus::Discontinuity:
+            throw domain_error("Критическая точка x = "+Rounding(x)+" (разрыв)");
+        case EvaluationStatus::Undefined:
+            throw out_of_range("Функция не определена в точке x = "+Rounding(x)+"!");
+        default:
+            return value;
+    }
+}
+
+// Значение в точке x сегмента i, найденного FindSegment
+template <typename T>
+EvaluationStatus SegmentFunction<T>::EvaluateSegment(size_t i, double x, T &result) const {
+    if (i == segments->GetLength()) return EvaluationStatus::Undefined;
+    const Segment<T> &segment = (*segments)[i];
+    if (x == segment.end) {
+        if (segment.junction == Junction::Jump) return EvaluationStatus::Discontinuity;
+        result = segment.endValue;
+    } else if (x == segment.start) {
+        result = segment.startValue;
+    } else {
+        result = segment.func(x);
+    }
+    return EvaluationStatus::Defined;
+}
+
+template <typename T>
+EvaluationStatus SegmentFunction<T>::TryCalculateAt(double x, T &result) {
+    if (cache && cache->Find(x, result)) return EvaluationStatus::Defined;
+    EvaluationStatus status = EvaluateSegment(FindSegment(x), x, result);
+    if (cache && status == EvaluationStatus::Defined) cache->Insert(x, result);
+    return status;
+}
+
+// Подряд идущие точки внутри одного сегмента с выражением вычисляются одним вызовом Evaluate.
+// Кэш проверяется только для первой точки такой серии, а значения блока в него не кладутся:
+// блок и так дешевле поиска в кэше, и серия не вытесняет из него одиночные точки
+template <typename T>
+size_t SegmentFunction<T>::TryCalculateAt(const double *xs, size_t count, T *results, EvaluationStatus *statuses) {
+    size_t defined = 0;
+    DynamicArray<double> values;
+    for (size_t i = 0; i < count;) {
+        if (cache && cache->Find(xs[i], results[i])) {
+            statuses[i++] = EvaluationStatus::Defined;
+            defined++;
+            continue;
+        }
+        size_t k = FindSegment(xs[i]), j = i;
+        if (k < segments->GetLength()) {
+            const Segment<T> &segment = (*segments)[k];
+            const ExpressionNode *node = dynamic_cast<const ExpressionNode*>(segment.node.get());
+            while (node && j < count && segment.start < xs[j] && xs[j] < segment.end) j++;
+            if (j-i > 1) {
+                if (values.GetSize() == 0) values.Resize(count);
+                node->expression.Evaluate(xs+i, j-i, &values[i]);
+                defined += j-i;
+                for (; i < j; i++) {
+                    results[i] = T(values[i]);
+                    statuses[i] = EvaluationStatus::Defined;
+                }
+                continue;
+            }
+        }
+        statuses[i] = EvaluateSegment(k, xs[i], results[i]);
+        if (statuses[i] == EvaluationStatus::Defined) {
+            if (cache) cache->Insert(xs[i], results[i]);
+            defined++;
+        }
+        i++;
+    }
+    return defined;
+}
+
+// Корень f(x) = y на [left, right], где значения на концах известны: в явном виде для монотонной формулы,
+// иначе методом Брента
+template <typename T>
+bool SegmentFunction<T>::SolveBetween(const Segment<T> &segment, double y, double left, double right, T leftValue, T rightValue, double &x) const {
+    if (SameValue(leftValue, T(y))) {
+        x = left;
+        return true;
+    }
+    if (SameValue(rightValue, T(y))) {
+        x = right;
+        return true;
     }
+    if (!((leftValue < y && y < rightValue) || (rightValue < y && y < leftValue))) return false;
+    bool monotone = segment.monotony == Monotony::Increasing || segment.monotony == Monotony::Decreasing;
+    if (monotone && segment.formula.Inverse(y, left, right, x)) return true;
+    auto g = [&segment, y](double t) {return segment.func(t)-y;};
+    x = Brent(g, left, right, leftValue-y, rightValue-y);
     return true;
 }
 
+// Перебирает корни f(x) = y на сегменте слева направо, пока visit(x) возвращает true;
+// внутри немонотонного сегмента корни ищутся между точками выборки
 template <typename T>
-bool SegmentFunction<T>::IsContinuous() const {
-    if (segments->GetLength() == 0) return false;
-    double prev_x = (*segments)[0].start;
-    T start, end, prev_y = (*segments)[0].func(prev_x);
-    for (size_t i = 0; i < segments->GetLength(); i++) {
-        Segment<T> &segment = (*segments)[i];
-        start = segment.func(segment.start);
-        end = segment.func(segment.end);
-        if (prev_x != segment.start || abs(prev_y-start) > 1e-12) return false;
-        prev_x = segment.end;
-        prev_y = end;
+template <typename Visitor>
+bool SegmentFunction<T>::VisitRoots(const Segment<T> &segment, double y, const Visitor &visit) const {
+    double x;
+    if (segment.monotony != Monotony::None) {
+        return !SolveBetween(segment, y, segment.start, segment.end, segment.startValue, segment.endValue, x) || visit(x);
+    }
+    if (y < segment.minValue || segment.maxValue < y) return true;
+    double left = segment.start, last = NAN;
+    T leftValue = segment.startValue;
+    for (size_t k = 1; k <= monotonicSamples; k++) {
+        double right = k == monotonicSamples ? segment.end : segment.start+(segment.end-segment.start)*k/monotonicSamples;
+        T rightValue = k == monotonicSamples ? segment.endValue : segment.func(right);
+        if (SolveBetween(segment, y, left, right, leftValue, rightValue, x) && x != last) {
+            if (!visit(x)) return false;
+            last = x;
+        }
+        left = right;
+        leftValue = rightValue;
     }
     return true;
 }
 
+// Решение f(x) = y без изменения состояния: двоичный поиск сегмента по значениям на концах для монотонной
+// функции, перебор сегментов (с отсевом по minValue/maxValue) для остальных
 template <typename T>
-T SegmentFunction<T>::CalculateAt(double x) {
+EvaluationStatus SegmentFunction<T>::SolveIn(double y, double &x, bool monotonic) const {
+    size_t n = segments->GetLength();
+    if (n == 0) return EvaluationStatus::Undefined;
+    if (!monotonic) {
+        bool found = false;
+        for (size_t i = 0; i < n && !found; i++) {
+            VisitRoots((*segments)[i], y, [&x, &found](double root) {
+                x = root;
+                found = true;
+                return false;
+            });
+        }
+        return found ? EvaluationStatus::Defined : EvaluationStatus::Undefined;
+    }
+    bool increasing = (*segments)[0].startValue < (*segments)[n-1].endValue;
+    auto before = [increasing](T value, double y) {
+        return !SameValue(value, T(y)) && (increasing ? value < y : y < value);
+    };
+    size_t left = 0, right = n;
+    while (left < right) {
+        size_t middle = left+(right-left)/2;
+        if (before((*segments)[middle].endValue, y)) left = middle+1;
+        else right = middle;
+    }
+    if (left == n) return EvaluationStatus::Undefined;
+    const Segment<T> &segment = (*segments)[left];
+    if (before(segment.startValue, y) || SameValue(segment.startValue, T(y))) {
+        return SolveBetween(segment, y, segment.start, segment.end, segment.startValue, segment.endValue, x) ?
+            EvaluationStatus::Defined : EvaluationStatus::Undefined;
+    }
+    return left == 0 ? EvaluationStatus::Undefined : EvaluationStatus::Discontinuity;
+}
+
+template <typename T>
+EvaluationStatus SegmentFunction<T>::TrySolve(double y, double &x) const {
+    bool monotonic = IsMonotonic();
+    if (!monotonic) AnalyzePending(false);
+    return SolveIn(y, x, monotonic);
+}
+
+template <typename T>
+double SegmentFunction<T>::Solve(double y) const {
+    double x;
+    switch (TrySolve(y, x)) {
+        case EvaluationStatus::Discontinuity:
+            throw domain_error("Значение y = "+Rounding(y)+" попадает в скачок функции!");
+        case EvaluationStatus::Undefined:
+            throw out_of_range("Функция не принимает значение y = "+Rounding(y)+"!");
+        default:
+            return x;
+    }
+}
+
+// Пакетное решение: анализ сегментов выполняется один раз, затем значения решаются параллельно
+template <typename T>
+size_t SegmentFunction<T>::TrySolve(const double *ys, size_t count, double *xs, EvaluationStatus *statuses) const {
+    bool monotonic = IsMonotonic();
+    if (!monotonic) AnalyzePending(false);
+    size_t chunks = ParallelThreads(count, parallelGrain);
+    DynamicArray<size_t> solved(chunks);
+    ParallelFor(count, parallelGrain, [&](size_t chunk, size_t begin, size_t end) {
+        solved[chunk] = 0;
+        for (size_t i = begin; i < end; i++) {
+            statuses[i] = SolveIn(ys[i], xs[i], monotonic);
+            if (statuses[i] == EvaluationStatus::Defined) solved[chunk]++;
+        }
+    });
+    size_t total = 0;
+    for (size_t chunk = 0; chunk < chunks; chunk++) total += solved[chunk];
+    return total;
+}
+
+// Все корни f(x) = y по возрастанию; для постоянного участка со значением y возвращается его начало
+template <typename T>
+Sequence<double>* SegmentFunction<T>::SolveAll(double y) const {
+    AnalyzePending(false);
+    ArraySequence<double> *roots = new ArraySequence<double>();
     for (size_t i = 0; i < segments->GetLength(); i++) {
-        const Segment<T> &left_segment = (*segments)[i];
-        if (left_segment.start <= x && x <= left_segment.end) {
-            if (x == left_segment.end && i < segments->GetLength()-1) {
-                const Segment<T> &right_segment = (*segments)[i+1];
-                if (x == right_segment.start && left_segment.func(x) != right_segment.func(x)) {
-                    throw domain_error("Критическая точка x = "+Rounding(x)+" (разрыв)");
-                }
+        VisitRoots((*segments)[i], y, [roots](double root) {
+            if (roots->GetLength() == 0 || roots->GetLast() != root) roots->Append(root);
+            return true;
+        });
+    }
+    return roots;
+}
+
+// Минимум и максимум на части [left, right] сегмента: целиком - из кэша сегмента, для формулы - в явном виде,
+// для монотонного - по концам, иначе по выборке из monotonicSamples шагов
+template <typename T>
+void SegmentFunction<T>::PartialExtrema(const Segment<T> &segment, double left, double right, T &low, T &high) const {
+    if (left == segment.start && right == segment.end) {
+        low = segment.minValue;
+        high = segment.maxValue;
+        return;
+    }
+    double formulaLow, formulaHigh;
+    if (segment.formula.Extrema(left, right, formulaLow, formulaHigh)) {
+        low = T(formulaLow);
+        high = T(formulaHigh);
+        return;
+    }
+    T leftValue = left == segment.start ? segment.startValue : segment.func(left);
+    T rightValue = right == segment.end ? segment.endValue : segment.func(right);
+    low = rightValue < leftValue ? rightValue : leftValue;
+    high = rightValue < leftValue ? leftValue : rightValue;
+    if (segment.monotony != Monotony::None) return;
+    for (size_t k = 1; k < monotonicSamples; k++) {
+        T value = segment.func(left+(right-left)*k/monotonicSamples);
+        if (value < low) low = value;
+        if (high < value) high = value;
+    }
+}
+
+// Крайние сегменты окна обрабатываются частично, между ними - запрос к разреженной таблице
+template <typename T>
+void SegmentFunction<T>::RangeExtrema(double a, double b, T &low, T &high) const {
+    if (a > b) throw invalid_argument("Неправильные аргументы!");
+    size_t from = LowerSegment(a), to = UpperSegment(b);
+    if (from >= to) throw out_of_range("Функция не определена на отрезке ["+Rounding(a)+", "+Rounding(b)+"]!");
+    if (to > from+1 && (*segments)[to-1].start == b && (*segments)[to-2].end == b) to--;
+    AnalyzePending(false);
+    if (!extremaTable.IsBuilt()) {
+        lock_guard<mutex> lock(lazyLock);
+        if (!extremaTable.IsBuilt()) extremaTable.Build(*segments);
+    }
+    const Segment<T> &first = (*segments)[from], &last = (*segments)[to-1];
+    PartialExtrema(first, max(a, first.start), min(b, first.end), low, high);
+    if (from+1 == to) return;
+    T partLow, partHigh;
+    PartialExtrema(last, max(a, last.start), min(b, last.end), partLow, partHigh);
+    if (from+2 < to) {
+        T tableLow = extremaTable.Min(from+1, to-2), tableHigh = extremaTable.Max(from+1, to-2);
+        if (tableLow < partLow) partLow = tableLow;
+        if (partHigh < tableHigh) partHigh = tableHigh;
+    }
+    if (partLow < low) low = partLow;
+    if (high < partHigh) high = partHigh;
+}
+
+template <typename T>
+T SegmentFunction<T>::RangeMin(double a, double b) const {
+    T low, high;
+    RangeExtrema(a, b, low, high);
+    return low;
+}
+
+template <typename T>
+T SegmentFunction<T>::RangeMax(double a, double b) const {
+    T low, high;
+    RangeExtrema(a, b, low, high);
+    return high;
+}
+
+// Массовая загрузка: заменяет все сегменты упорядоченным набором без пересечений, минуя Define
+template <typename T>
+void SegmentFunction<T>::Assign(Segment<T> *items, size_t count) {
+    Assign(items, count, false);
+}
+
+// Заменяет все сегменты упорядоченным набором без пересечений за один проход, минуя Define;
+// при keepAnalysis монотонность, экстремумы и интегралы сегментов считаются актуальными
+template <typename T>
+void SegmentFunction<T>::Assign(Segment<T> *items, size_t count, bool keepAnalysis) {
+    for (size_t i = 0; i < count; i++) {
+        if (!(items[i].start < items[i].end) || (i > 0 && items[i].start < items[i-1].end)) {
+            throw invalid_argument("Сегменты должны быть упорядочены и не пересекаться!");
+        }
+        if (keepAnalysis) continue;
+        items[i].monotony = Monotony::Unknown;
+        items[i].integrated = false;
+    }
+    Replace(new ArraySequence<Segment<T>>(items, count));
+}
+
+// Подменяет таблицу уже проверенной и сбрасывает всё, что от неё зависит
+template <typename T>
+void SegmentFunction<T>::Replace(Sequence<Segment<T>> *table) {
+    delete segments;
+    segments = table;
+    cursor = 0;
+    segmentIndex.Invalidate();
+    extremaTable.Invalidate();
+    if (cache) cache->Clear();
+    if (prefix) prefix->valid = 0;
+    totals = SegmentTotals();
+    Attach(0, segments->GetLength(), -INFINITY, INFINITY);
+}
+
+// Соседи без разрыва сливаются при одинаковой формуле, а без формулы - при одном и том же указателе
+// на функцию: произвольные function<T(double)> сравнить нельзя. id для этого не годится - половины
+// разрезанного Define сегмента получают разные id, чтобы живые сегменты различались по нему
+template <typename T>
+bool SegmentFunction<T>::Mergeable(const Segment<T> &left, const Segment<T> &right) {
+    if (left.end != right.start) return false;
+    if (!left.formula.IsOpaque() || !right.formula.IsOpaque()) return left.formula == right.formula;
+    typedef T (*Pointer)(double);
+    const Pointer *first = left.func.template target<Pointer>(), *second = right.func.template target<Pointer>();
+    return first && second && *first == *second;
+}
+
+// Сжимает упорядоченный массив на месте и возвращает новую длину: обрезок не шире width отдаётся соседу
+// слева (или справа, если слева разрыв) либо выбрасывается, соседи с одной функцией сливаются
+template <typename T>
+size_t SegmentFunction<T>::Fold(Segment<T> *items, size_t count, double width, CompactionStatistics &statistics) {
+    auto reset = [](Segment<T> &segment) {
+        segment.monotony = Monotony::Unknown;
+        segment.integrated = false;
+    };
+    size_t length = 0;
+    bool carry = false;
+    double carryStart = 0;
+    for (size_t i = 0; i < count; i++) {
+        Segment<T> &segment = items[i];
+        if (carry) {
+            segment.start = carryStart;
+            segment.startValue = segment.func(segment.start);
+            reset(segment);
+            carry = false;
+        }
+        if (segment.end-segment.start <= width) {
+            statistics.slivers++;
+            if (length > 0 && items[length-1].end == segment.start) {
+                Segment<T> &previous = items[length-1];
+                previous.end = segment.end;
+                previous.endValue = previous.func(previous.end);
+                reset(previous);
+            } else if (i+1 < count && segment.end == items[i+1].start) {
+                carry = true;
+                carryStart = segment.start;
+            }
+            continue;
+        }
+        if (length > 0 && Mergeable(items[length-1], segment)) {
+            Segment<T> &previous = items[length-1];
+            previous.end = segment.end;
+            previous.endValue = segment.endValue;
+            reset(previous);
+            statistics.merged++;
+            continue;
+        }
+        if (length != i) items[length] = segment;
+        length++;
+    }
+    return length;
+}
+
+// Сжатие окна сегментов [from, to) вокруг только что определённого вместе с соседями
+template <typename T>
+void SegmentFunction<T>::CompactNear(size_t from, size_t to) {
+    if (from > 0) from--;
+    to = min(to, segments->GetLength());
+    if (to <= from) return;
+    DynamicArray<Segment<T>> items(to-from);
+    for (size_t i = from; i < to; i++) items[i-from] = (*segments)[i];
+    CompactionStatistics statistics;
+    size_t count = Fold(&items[0], to-from, sliverWidth, statistics);
+    if (count == to-from) return;
+    size_t first = from > 0 ? from-1 : 0;
+    if (cache) cache->Invalidate((*segments)[from].start, (*segments)[to-1].end);
+    if (prefix && prefix->valid > first) prefix->valid = first;
+    Detach(first, to);
+    for (size_t k = 0; k < count; k++) (*segments)[from+k] = items[k];
+    for (size_t k = count; k < to-from; k++) segments->Remove(from+count);
+    Attach(first, from+count, INFINITY, -INFINITY);
+    compaction += statistics;
+}
+
+// Приближает каждый сегмент без формулы кусочно-чебышёвским многочленом с ошибкой не больше tolerance;
+// сегменты с формулой переносятся как есть, как и сегменты с не конечными значениями или не уложившиеся
+// в допуск (последние два случая считаются в skipped)
+template <typename T>
+SegmentFunction<T> SegmentFunction<T>::Compile(double tolerance, CompilationReport *report) const {
+    if (!(tolerance > 0)) throw invalid_argument("Неправильный допуск!");
+    size_t n = segments->GetLength();
+    DynamicArray<shared_ptr<const ChebyshevTable>> tables(n);
+    DynamicArray<double> errors(n);
+    ParallelFor(n, parallelGrain, [&](size_t, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            const Segment<T> &segment = (*segments)[i];
+            errors[i] = 0;
+            if (segment.formula.IsOpaque()) {
+                tables[i] = ChebyshevTable::Compile(segment.func, segment.start, segment.end, tolerance, errors[i]);
+            }
+        }
+    });
+    CompilationReport summary;
+    DynamicArray<Segment<T>> items(n);
+    for (size_t i = 0; i < n; i++) {
+        const Segment<T> &segment = (*segments)[i];
+        if (tables[i]) {
+            shared_ptr<const ChebyshevTable> table = tables[i];
+            items[i] = Segment<T>(segment.start, segment.end, [table](double x) {return T((*table)(x));});
+            summary.segments++;
+            summary.pieces += table->GetPieces();
+            summary.bytes += table->GetBytes();
+            summary.maxError = max(summary.maxError, errors[i]);
+        } else {
+            items[i] = Segment<T>(segment.start, segment.end, segment.func, segment.formula);
+            if (segment.formula.IsOpaque()) summary.skipped++;
+        }
+    }
+    SegmentFunction<T> result;
+    result.monotonicSamples = monotonicSamples;
+    if (n > 0) result.Assign(&items[0], n);
+    if (report) *report = summary;
+    return result;
+}
+
+// Сливает соседние сегменты с одной функцией и убирает обрезки не шире width за один проход;
+// анализ и интегралы нетронутых сегментов сохраняются
+template <typename T>
+CompactionStatistics SegmentFunction<T>::Compact(double width) {
+    if (!(width >= 0)) throw invalid_argument("Неправильный допуск!");
+    CompactionStatistics statistics;
+    size_t n = segments->GetLength();
+    if (n == 0) return statistics;
+    DynamicArray<Segment<T>> items(n);
+    for (size_t i = 0; i < n; i++) items[i] = (*segments)[i];
+    size_t count = Fold(&items[0], n, width, statistics);
+    if (count < n) Assign(&items[0], count, true);
+    compaction += statistics;
+    return statistics;
+}
+
+// Сегмент результата операции на пересечении [start, end] сегментов операндов: формула при символьном
+// результате, иначе одна плоская цепочка членов операндов (с той же операцией - их членов) с формулами,
+// сложенными символьно, где это возможно
+template <typename T>
+Segment<T> SegmentFunction<T>::CombineSegments(const Segment<T> &left, const Segment<T> &right, double start, double end, Operation operation) {
+    Formula formula;
+    if (Formula::Combine(operation, left.formula, right.formula, start, end, formula)) {
+        return Segment<T>(start, end, [formula](double x) {return T(formula(x));}, formula);
+    }
+    if (operation == Operation::Divide) {
+        function<T(double)> f = left.func, g = right.func;
+        return Segment<T>(start, end, [f, g](double x) {return f(x)/g(x);});
+    }
+    Operation family = operation == Operation::Subtract ? Operation::Add : operation;
+    auto chainOf = [family](const Segment<T> &segment) {
+        const ChainNode<T> *chain = dynamic_cast<const ChainNode<T>*>(segment.node.get());
+        return chain && chain->operation == family ? chain : nullptr;
+    };
+    const ChainNode<T> *leftChain = chainOf(left), *rightChain = chainOf(right);
+    DynamicArray<ChainTerm<T>> terms((leftChain ? leftChain->terms.GetSize() : 1)+(rightChain ? rightChain->terms.GetSize() : 1));
+    size_t count = 0;
+    auto append = [&](const ChainTerm<T> &term) {
+        for (size_t k = 0; k < count && !term.formula.IsOpaque(); k++) {
+            if (terms[k].formula.IsOpaque()) continue;
+            Operation merge = family == Operation::Add && terms[k].inverse != term.inverse ? Operation::Subtract : family;
+            if (Formula::Combine(merge, terms[k].formula, term.formula, start, end, formula)) {
+                terms[k].formula = formula;
+                terms[k].func = [formula](double x) {return T(formula(x));};
+                return;
+            }
+        }
+        terms[count++] = term;
+    };
+    bool negate = operation == Operation::Subtract;
+    if (leftChain) {
+        for (size_t k = 0; k < leftChain->terms.GetSize(); k++) append(leftChain->terms[k]);
+    } else {
+        append(ChainTerm<T>(left.func, left.formula, false));
+    }
+    if (rightChain) {
+        for (size_t k = 0; k < rightChain->terms.GetSize(); k++) {
+            ChainTerm<T> term = rightChain->terms[k];
+            term.inverse = term.inverse != negate;
+            append(term);
+        }
+    } else {
+        append(ChainTerm<T>(right.func, right.formula, negate));
+    }
+    if (family == Operation::Add || family == Operation::Multiply) {
+        Formula neutral = Formula::Constant(family == Operation::Add ? 0 : 1);
+        size_t kept = 0;
+        for (size_t k = 0; k < count; k++) {
+            if (!(terms[k].formula == neutral) || (kept == 0 && k+1 == count)) terms[kept++] = terms[k];
+        }
+        count = kept;
+    }
+    if (count == 1 && !terms[0].inverse) {
+        formula = terms[0].formula;
+        if (formula.IsOpaque()) return Segment<T>(start, end, terms[0].func);
+        return Segment<T>(start, end, [formula](double x) {return T(formula(x));}, formula);
+    }
+    shared_ptr<const ChainNode<T>> chain = make_shared<const ChainNode<T>>(family, DynamicArray<ChainTerm<T>>(&terms[0], count));
+    Segment<T> segment(start, end, [chain](double x) {return (*chain)(x);});
+    segment.node = chain;
+    return segment;
+}
+
+// Поточечная операция за один проход слиянием сегментов; результат определён на пересечении областей
+template <typename T>
+SegmentFunction<T> SegmentFunction<T>::Combine(const SegmentFunction<T> &other, Operation operation) const {
+    size_t n = segments->GetLength(), m = other.segments->GetLength(), count = 0, i = 0, j = 0;
+    DynamicArray<Segment<T>> items(n+m);
+    while (i < n && j < m) {
+        const Segment<T> &left = (*segments)[i], &right = (*other.segments)[j];
+        double start = max(left.start, right.start), end = min(left.end, right.end);
+        if (start < end) items[count++] = CombineSegments(left, right, start, end, operation);
+        if (left.end < right.end) i++;
+        else j++;
+    }
+    SegmentFunction<T> result;
+    result.monotonicSamples = monotonicSamples;
+    if (count > 0) result.Assign(&items[0], count);
+    return result;
+}
+
+// Композиция f(inner(x)): каждый сегмент inner режется в корнях inner(x) = границе сегмента f,
+// куски, значения которых выходят из области f, отбрасываются
+template <typename T>
+SegmentFunction<T> SegmentFunction<T>::Compose(const SegmentFunction<double> &inner) const {
+    inner.AnalyzePending(false);
+    size_t n = inner.segments->GetLength(), count = 0;
+    DynamicArray<Segment<T>> items(n+segments->GetLength());
+    DynamicArray<double> cuts(2);
+    for (size_t i = 0; i < n; i++) {
+        const Segment<double> &segment = (*inner.segments)[i];
+        size_t cutsCount = 0;
+        auto add = [&cuts, &cutsCount](double x) {
+            if (cutsCount == cuts.GetSize()) cuts.Resize(2*cutsCount);
+            cuts[cutsCount++] = x;
+            return true;
+        };
+        add(segment.start);
+        add(segment.end);
+        double low = segment.minValue, high = segment.maxValue;
+        for (size_t k = LowerSegment(low); k < segments->GetLength() && (*segments)[k].start <= high; k++) {
+            for (double boundary: {(*segments)[k].start, (*segments)[k].end}) {
+                if (low < boundary && boundary < high) inner.VisitRoots(segment, boundary, add);
+            }
+        }
+        sort(&cuts[0], &cuts[0]+cutsCount);
+        for (size_t k = 0; k+1 < cutsCount; k++) {
+            double left = cuts[k], right = cuts[k+1];
+            if (!(segment.start <= left && left < right && right <= segment.end)) continue;
+            double value = segment.func((left+right)/2);
+            size_t owner = UpperSegment(value);
+            // Середина куска может лишь коснуться точки излома внешней функции (вершина параболы, пик синуса):
+            // тогда сегмент выбирается по той стороне, куда уходят остальные значения куска
+            if (owner > 1 && (*segments)[owner-1].start == value && (*segments)[owner-2].end == value) {
+                double pieceLow, pieceHigh;
+                inner.PartialExtrema(segment, left, right, pieceLow, pieceHigh);
+                if (value-pieceLow > pieceHigh-value) owner--;
+            }
+            if (owner == 0 || !((*segments)[owner-1].end >= value)) continue;
+            const Segment<T> &outer = (*segments)[owner-1];
+            Formula formula;
+            if (count == items.GetSize()) items.Resize(2*count+1);
+            if (outer.formula.Compose(segment.formula, formula)) {
+                items[count++] = Segment<T>(left, right, [formula](double x) {return T(formula(x));}, formula);
+            } else {
+                function<T(double)> f = outer.func;
+                function<double(double)> g = segment.func;
+                items[count++] = Segment<T>(left, right, [f, g](double x) {return f(g(x));});
             }
-            return left_segment.func(x);
         }
     }
-    throw out_of_range("Функция не определена в точке x = "+Rounding(x)+"!");
+    SegmentFunction<T> result;
+    result.monotonicSamples = monotonicSamples;
+    if (count > 0) result.Assign(&items[0], count);
+    return result;
 }
 
 // Перегрузка операторов
@@ -265,9 +1427,20 @@ template <typename T>
 SegmentFunction<T>& SegmentFunction<T>::operator=(const SegmentFunction<T> &other) {
     if (this != &other) {
         delete segments;
+        segmentIndex.Invalidate();
+        extremaTable.Invalidate();
+        if (cache) cache->Clear();
+        if (prefix) prefix->valid = 0;
         segments = new ArraySequence<Segment<T>>();
+        cursor = 0;
+        monotonicSamples = other.monotonicSamples;
+        autoCompact = other.autoCompact;
+        sliverWidth = other.sliverWidth;
+        lock_guard<mutex> lock(other.lazyLock);
+        totals = other.totals;
         for (size_t i = 0; i < other.GetSize(); i++) {
-            Segment<T> segment = other.Get(i);
+            Segment<T> segment = (*other.segments)[i];
+            if (prefix && (!other.prefix || other.prefix->tolerance != prefix->tolerance)) segment.integrated = false;
             segments->Append(segment);
         }
     }
@@ -278,8 +1451,23 @@ template <typename T>
 SegmentFunction<T>& SegmentFunction<T>::operator=(SegmentFunction<T> &&other) {
     if (this != &other) {
         delete segments;
+        delete cache;
+        delete prefix;
+        segmentIndex.Invalidate();
+        extremaTable.Invalidate();
         segments = other.segments;
+        cache = other.cache;
+        prefix = other.prefix;
+        cursor = 0;
+        totals = other.totals;
+        monotonicSamples = other.monotonicSamples;
+        autoCompact = other.autoCompact;
+        sliverWidth = other.sliverWidth;
         other.segments = nullptr;
+        other.cache = nullptr;
+        other.prefix = nullptr;
+        other.segmentIndex.Invalidate();
+        other.extremaTable.Invalidate();
     }
     return *this;
 }
@@ -302,7 +1490,7 @@ SegmentFunction<T> SegmentFunction<T>::Where(function<bool(Segment<T>)> func) {
     SegmentFunction<T> result;
     for (size_t i = 0; i < segments->GetLength(); i++) {
         Segment<T> &segment = (*segments)[i];
-        if (func(segment)) result.Define(segment.start, segment.end, segment.func);
+        if (func(segment)) result.DefineSegment(segment.start, segment.end, segment.func, segment.formula, segment.node);
     }
     return result;
 }
@@ -316,62 +1504,195 @@ T SegmentFunction<T>::Reduce(function<T(T, Segment<T>)> func, T start) {
     return start;
 }
 
+// Компоненты двух половин одного Unzip снова дают исходную функцию пары, иначе пара запоминает
+// свои компоненты, чтобы Unzip мог вернуть их без обёрток
 template <typename T>
 template <typename U>
 SegmentFunction<pair<T, U>> SegmentFunction<T>::Zip(SegmentFunction<U> &other) {
-    SegmentFunction<pair<T, U>> result;
-    size_t i = 0, j = 0;
-    while (i < segments->GetLength() && j < other.segments->GetLength()) {
+    size_t n = segments->GetLength(), m = other.segments->GetLength(), count = 0, i = 0, j = 0;
+    DynamicArray<Segment<pair<T, U>>> items(n+m);
+    while (i < n && j < m) {
         Segment<T> &segment1 = (*segments)[i];
         Segment<U> &segment2 = (*other.segments)[j];
         double start = max(segment1.start, segment2.start);
         double end = min(segment1.end, segment2.end);
         if (start < end) {
-            function<pair<T, U>(double)> newFunction = [segment1, segment2](double x) {
-                return make_pair(segment1.func(x), segment2.func(x));
-            };
-            result.Define(start, end, newFunction);
+            const PartNode<pair<T, U>> *part1 = dynamic_cast<const PartNode<pair<T, U>>*>(segment1.node.get());
+            const PartNode<pair<T, U>> *part2 = dynamic_cast<const PartNode<pair<T, U>>*>(segment2.node.get());
+            if (part1 && part2 && !part1->second && part2->second && part1->parent == part2->parent) {
+                items[count] = Segment<pair<T, U>>(start, end, *part1->parent);
+                items[count].node = part1->parentNode;
+            } else {
+                function<T(double)> first = segment1.func;
+                function<U(double)> second = segment2.func;
+                items[count] = Segment<pair<T, U>>(start, end, [first, second](double x) {
+                    return make_pair(first(x), second(x));
+                });
+                items[count].node = make_shared<const PairNode<T, U>>(first, second, segment1.formula, segment2.formula,
+                                                                      segment1.node, segment2.node);
+            }
+            count++;
         }
         if (segment1.end < segment2.end) i++;
         else j++;
     }
+    SegmentFunction<pair<T, U>> result;
+    if (count > 0) result.Assign(&items[0], count);
     return result;
 }
 
+// Пара, построенная Zip, распадается на исходные компоненты; иначе обе половины ссылаются на общую функцию пары
 template <typename T>
 template <typename U, typename V>
 pair<SegmentFunction<U>, SegmentFunction<V>> SegmentFunction<T>::Unzip(SegmentFunction<pair<U, V>> &other) {
+    size_t n = other.GetSize();
+    DynamicArray<Segment<U>> firstItems(n);
+    DynamicArray<Segment<V>> secondItems(n);
+    for (size_t i = 0; i < n; i++) {
+        const Segment<pair<U, V>> &segment = (*other.segments)[i];
+        const PairNode<U, V> *zipped = dynamic_cast<const PairNode<U, V>*>(segment.node.get());
+        if (zipped) {
+            firstItems[i] = Segment<U>(segment.start, segment.end, zipped->first, zipped->firstFormula);
+            firstItems[i].node = zipped->firstNode;
+            secondItems[i] = Segment<V>(segment.start, segment.end, zipped->second, zipped->secondFormula);
+            secondItems[i].node = zipped->secondNode;
+            continue;
+        }
+        shared_ptr<const function<pair<U, V>(double)>> parent = make_shared<const function<pair<U, V>(double)>>(segment.func);
+        firstItems[i] = Segment<U>(segment.start, segment.end, [parent](double x) {return (*parent)(x).first;});
+        firstItems[i].node = make_shared<const PartNode<pair<U, V>>>(parent, segment.node, false);
+        secondItems[i] = Segment<V>(segment.start, segment.end, [parent](double x) {return (*parent)(x).second;});
+        secondItems[i].node = make_shared<const PartNode<pair<U, V>>>(parent, segment.node, true);
+    }
     SegmentFunction<U> first;
     SegmentFunction<V> second;
-    for (size_t i = 0; i < other.GetSize(); i++) {
-        auto segment = other.Get(i);
-        auto firstFunction = [segment](double x) {return segment.func(x).first;};
-        auto secondFunction = [segment](double x) {return segment.func(x).second;};
-        first.Define(segment.start, segment.end, firstFunction);
-        second.Define(segment.start, segment.end, secondFunction);
+    if (n > 0) {
+        first.Assign(&firstItems[0], n);
+        second.Assign(&secondItems[0], n);
     }
     return {move(first), move(second)};
 }
 
+// Сохраняются только сегменты с формулой или выражением (в замороженной таблице - только с формулой):
+// произвольную function<T(double)> записать нельзя, поэтому сегменты проверяются до записи,
+// чтобы не оставить в потоке обрезанную таблицу
 template <typename T>
-class ImmutableSegmentFunction: public SegmentFunction<T> {
-    public:
-        ImmutableSegmentFunction(const SegmentFunction<T> &other): SegmentFunction<T>() {
-            this->segments = new ArraySequence<Segment<T>>();
-            for (size_t i = 0; i < other.GetSize(); ++i) {
-                Segment<T> segment = other.Get(i);
-                this->segments->Append(segment);
-            }
+void SegmentFunction<T>::Save(ostream &out, bool frozen) const {
+    size_t length = segments->GetLength();
+    for (size_t i = 0; i < length; i++) {
+        const Segment<T> &segment = (*segments)[i];
+        if (segment.formula.IsOpaque() && (frozen || !dynamic_cast<const ExpressionNode*>(segment.node.get()))) {
+            throw invalid_argument("Сегмент [" + Rounding(segment.start) + ", " + Rounding(segment.end) +
+                                   "] задан без формулы и не может быть сохранён!");
         }
-        ImmutableSegmentFunction(SegmentFunction<T> &&other): SegmentFunction<T>() {
-            this->segments = other.segments;
-            other.segments = nullptr;
+    }
+    SegmentWriter writer(out, length, frozen ? frozenFlag : 0);
+    for (size_t i = 0; i < length; i++) {
+        const Segment<T> &segment = (*segments)[i];
+        if (!segment.formula.IsOpaque()) writer.Write(segment.start, segment.end, segment.formula);
+        else writer.Write(segment.start, segment.end, static_cast<const ExpressionNode&>(*segment.node).expression);
+    }
+    writer.Finish();
+}
+
+// Сегменты собираются в массив и загружаются одним Assign; подряд идущие одинаковые выражения разбираются один раз.
+// Массив растёт удвоением, а не по объявленному в заголовке числу, чтобы испорченный заголовок не занял всю память
+template <typename T>
+SegmentFunction<T> SegmentFunction<T>::Load(istream &in) {
+    SegmentReader reader(in);
+    DynamicArray<Segment<T>> items(static_cast<size_t>(min<uint64_t>(reader.GetCount(), 1 << 16)));
+    shared_ptr<const ExpressionNode> node;
+    SegmentRecord record;
+    size_t count = 0;
+    while (reader.Next(record)) {
+        if (count == items.GetSize()) items.Resize(2*count);
+        if (record.expression) {
+            if (!node || node->expression.GetText() != record.text) node = make_shared<const ExpressionNode>(Expression::Parse(record.text));
+            Expression expression = node->expression;
+            items[count] = Segment<T>(record.start, record.end, [expression](double x) {return T(expression(x));});
+            items[count].node = node;
+        } else {
+            Formula formula = record.formula;
+            items[count] = Segment<T>(record.start, record.end, [formula](double x) {return T(formula(x));}, formula);
         }
+        count++;
+    }
+    SegmentFunction<T> result;
+    if (count > 0) result.Assign(&items[0], count);
+    return result;
+}
+
+// CSV читается потоково (см. CsvReader): строки каждого куска проверяются на порядок сразу по прочтении,
+// с концом последней строки предыдущего куска. Копится только компактная таблица строк, сегменты
+// создаются один раз прямо в итоговой таблице, которая передаётся функции без копирования
+template <typename T>
+SegmentFunction<T> SegmentFunction<T>::Import(istream &in, bool parallel) {
+    CsvReader reader(in, parallel);
+    DynamicArray<CsvRow> rows;
+    size_t count = 0, checked = 0;
+    while (reader.Next(rows, count)) {
+        for (; checked < count; checked++) {
+            const CsvRow &row = rows[checked];
+            if (!(row.start < row.end) || (checked > 0 && row.start < rows[checked-1].end)) {
+                throw invalid_argument("Ошибка в CSV (строка " + to_string(row.line) + "): сегменты должны быть упорядочены и не пересекаться!");
+            }
+        }
+    }
+    DynamicArray<Segment<T>> items(count);
+    for (size_t i = 0; i < count; i++) {
+        Formula formula = rows[i].formula;
+        items[i] = Segment<T>(rows[i].start, rows[i].end, [formula](double x) {return T(formula(x));}, formula);
+    }
+    SegmentFunction<T> result;
+    if (count > 0) result.Replace(new ArraySequence<Segment<T>>(move(items)));
+    return result;
+}
+
+// Арифметика и min/max над функциями: сегменты результата - пересечения сегментов операндов
+template <typename T>
+SegmentFunction<T> operator+(const SegmentFunction<T> &left, const SegmentFunction<T> &right) {
+    return left.Combine(right, Operation::Add);
+}
+
+template <typename T>
+SegmentFunction<T> operator-(const SegmentFunction<T> &left, const SegmentFunction<T> &right) {
+    return left.Combine(right, Operation::Subtract);
+}
+
+template <typename T>
+SegmentFunction<T> operator*(const SegmentFunction<T> &left, const SegmentFunction<T> &right) {
+    return left.Combine(right, Operation::Multiply);
+}
+
+template <typename T>
+SegmentFunction<T> operator/(const SegmentFunction<T> &left, const SegmentFunction<T> &right) {
+    return left.Combine(right, Operation::Divide);
+}
+
+template <typename T>
+SegmentFunction<T> Min(const SegmentFunction<T> &left, const SegmentFunction<T> &right) {
+    return left.Combine(right, Operation::Min);
+}
+
+template <typename T>
+SegmentFunction<T> Max(const SegmentFunction<T> &left, const SegmentFunction<T> &right) {
+    return left.Combine(right, Operation::Max);
+}
+
+template <typename T>
+class ImmutableSegmentFunction: public SegmentFunction<T> {
+    public:
+        ImmutableSegmentFunction(const SegmentFunction<T> &other): SegmentFunction<T>(other) {}
+        ImmutableSegmentFunction(SegmentFunction<T> &&other): SegmentFunction<T>(move(other)) {}
         ImmutableSegmentFunction(const ImmutableSegmentFunction&) = delete;
         ImmutableSegmentFunction& operator=(const ImmutableSegmentFunction&) = delete;
         T operator()(double x) {return SegmentFunction<T>::operator()(x);}
         void Define(double, double, std::function<T(double)>) = delete;
+        void Define(double, double, const Formula&) = delete;
+        void Define(double, double, const Expression&) = delete;
         void Clear() = delete;
+        void Assign(Segment<T>*, size_t) = delete;
+        CompactionStatistics Compact(double) = delete;
 };
 
 #endif // SEGMENTFUNCTION_HPP
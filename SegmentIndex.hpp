@@ -0,0 +1,149 @@
+#ifndef SEGMENTINDEX_HPP
+#define SEGMENTINDEX_HPP
+
+#include <atomic>
+#include <cmath>
+#include <stdexcept>
+#include "sequences/Sequence.hpp"
+#include "sequences/DynamicArray.hpp"
+
+
+// Индекс для поиска сегмента по точке: равномерная сетка (O(1) арифметикой)
+// или корзины по [start, end] функции с двоичным поиском внутри корзины
+class SegmentIndex {
+    private:
+        DynamicArray<double> *starts;
+        DynamicArray<double> *ends;
+        DynamicArray<size_t> *buckets;
+        size_t count;
+        double origin;
+        double step;
+        std::atomic<bool> built;
+        bool uniform;
+        template <typename S>
+        void Fill(const Sequence<S> &segments);
+        size_t LowerBound(double x, size_t left, size_t right) const;
+    public:
+        // Создание объекта
+        SegmentIndex();
+        ~SegmentIndex();
+        SegmentIndex(const SegmentIndex&) = delete;
+        SegmentIndex& operator=(const SegmentIndex&) = delete;
+
+        // Декомпозиция
+        bool IsBuilt() const;
+        bool IsUniform() const;
+
+        // Операции
+        template <typename S>
+        void Build(const Sequence<S> &segments);
+        void Invalidate();
+        size_t Find(double x) const;
+};
+
+// Создание объекта
+inline SegmentIndex::SegmentIndex() {
+    starts = nullptr;
+    ends = nullptr;
+    buckets = nullptr;
+    count = 0;
+    origin = 0;
+    step = 0;
+    built = false;
+    uniform = false;
+}
+
+inline SegmentIndex::~SegmentIndex() {
+    Invalidate();
+}
+
+// Декомпозиция
+inline bool SegmentIndex::IsBuilt() const {
+    return built.load(std::memory_order_acquire);
+}
+
+inline bool SegmentIndex::IsUniform() const {
+    return IsBuilt() && uniform;
+}
+
+// Операции
+// Флаг built выставляется последним: поток, увидевший его, видит и готовый индекс
+template <typename S>
+void SegmentIndex::Build(const Sequence<S> &segments) {
+    Invalidate();
+    Fill(segments);
+    built.store(true, std::memory_order_release);
+}
+
+template <typename S>
+void SegmentIndex::Fill(const Sequence<S> &segments) {
+    count = segments.GetLength();
+    if (count == 0) return;
+    starts = new DynamicArray<double>(count);
+    ends = new DynamicArray<double>(count);
+    for (size_t i = 0; i < count; i++) {
+        (*starts)[i] = segments[i].start;
+        (*ends)[i] = segments[i].end;
+    }
+    origin = (*starts)[0];
+    step = ((*ends)[count-1]-origin)/count;
+    uniform = true;
+    for (size_t i = 0; i < count && uniform; i++) {
+        double width = (*ends)[i]-(*starts)[i];
+        if (std::abs(width-step) > 1e-9*step || (i > 0 && (*ends)[i-1] != (*starts)[i])) uniform = false;
+    }
+    if (uniform) return;
+    buckets = new DynamicArray<size_t>(count+1);
+    size_t j = 0;
+    for (size_t b = 0; b <= count; b++) {
+        double border = origin+b*step;
+        while (j < count && (*ends)[j] < border) j++;
+        (*buckets)[b] = j;
+    }
+}
+
+inline void SegmentIndex::Invalidate() {
+    delete starts;
+    delete ends;
+    delete buckets;
+    starts = nullptr;
+    ends = nullptr;
+    buckets = nullptr;
+    count = 0;
+    built = false;
+    uniform = false;
+}
+
+inline size_t SegmentIndex::LowerBound(double x, size_t left, size_t right) const {
+    while (left < right) {
+        size_t middle = left+(right-left)/2;
+        if ((*ends)[middle] < x) left = middle+1;
+        else right = middle;
+    }
+    return left;
+}
+
+// Индекс самого левого сегмента, содержащего x (count, если такого нет)
+inline size_t SegmentIndex::Find(double x) const {
+    if (count == 0 || x < origin || x > (*ends)[count-1]) return count;
+    size_t cell = step > 0 ? static_cast<size_t>((x-origin)/step) : 0;
+    if (cell >= count) cell = count-1;
+    size_t i;
+    if (uniform) {
+        i = cell;
+        while (i > 0 && (*ends)[i-1] >= x) i--;
+        while (i < count && (*ends)[i] < x) i++;
+    } else {
+        size_t left = (*buckets)[cell], right = (*buckets)[cell+1];
+        if (right < count) right++;
+        if ((left > 0 && (*ends)[left-1] >= x) || (right < count && (*ends)[right-1] < x)) {
+            left = 0;
+            right = count;
+        }
+        i = LowerBound(x, left, right);
+    }
+    if (i < count && (*starts)[i] <= x) return i;
+    return count;
+}
+
+#endif // SEGMENTINDEX_HPP
@@ -0,0 +1,100 @@
+#ifndef SEGMENTNODE_HPP
+#define SEGMENTNODE_HPP
+
+#include <functional>
+#include <memory>
+#include <utility>
+#include "Formula.hpp"
+#include "sequences/DynamicArray.hpp"
+
+
+// Узел выражения, из которого построена функция сегмента: операции над функциями смотрят на него,
+// чтобы упрощать цепочки (Unzip(Zip(f, g)) -> f, (f+g)+h -> одна сумма), а не вкладывать замыкания
+class SegmentNode {
+    public:
+        virtual ~SegmentNode() {}
+};
+
+// Zip: компоненты пары вместе с их формулами и узлами
+template <typename T, typename U>
+class PairNode: public SegmentNode {
+    public:
+        std::function<T(double)> first;
+        std::function<U(double)> second;
+        Formula firstFormula;
+        Formula secondFormula;
+        std::shared_ptr<const SegmentNode> firstNode;
+        std::shared_ptr<const SegmentNode> secondNode;
+        PairNode(const std::function<T(double)> &first, const std::function<U(double)> &second,
+                 const Formula &firstFormula, const Formula &secondFormula,
+                 const std::shared_ptr<const SegmentNode> &firstNode, const std::shared_ptr<const SegmentNode> &secondNode):
+            first(first), second(second), firstFormula(firstFormula), secondFormula(secondFormula),
+            firstNode(firstNode), secondNode(secondNode) {}
+};
+
+// Unzip: компонента пары; у обеих компонент одного сегмента общий parent
+template <typename P>
+class PartNode: public SegmentNode {
+    public:
+        std::shared_ptr<const std::function<P(double)>> parent;
+        std::shared_ptr<const SegmentNode> parentNode;
+        bool second;
+        PartNode(const std::shared_ptr<const std::function<P(double)>> &parent, const std::shared_ptr<const SegmentNode> &parentNode, bool second):
+            parent(parent), parentNode(parentNode), second(second) {}
+};
+
+// Член цепочки: формула хранится для символьного сложения с другими членами; inverse - вычитаемое в сумме
+template <typename T>
+struct ChainTerm {
+    std::function<T(double)> func;
+    Formula formula;
+    bool inverse;
+    ChainTerm(): func(nullptr), formula(), inverse(false) {}
+    ChainTerm(const std::function<T(double)> &func, const Formula &formula, bool inverse):
+        func(func), formula(formula), inverse(inverse) {}
+    T operator()(double x) const {
+        return func(x);
+    }
+};
+
+// Ассоциативная операция над плоским списком членов: Add (с вычитаемыми), Multiply, Min или Max
+template <typename T>
+class ChainNode: public SegmentNode {
+    public:
+        Operation operation;
+        DynamicArray<ChainTerm<T>> terms;
+        ChainNode(Operation operation, const DynamicArray<ChainTerm<T>> &terms): operation(operation), terms(terms) {}
+        T operator()(double x) const;
+};
+
+template <typename T>
+T ChainNode<T>::operator()(double x) const {
+    const ChainTerm<T> *term = &terms[0], *last = term+terms.GetSize();
+    T value = (*term)(x);
+    if (term->inverse) value = T()-value;
+    switch (operation) {
+        case Operation::Add:
+            for (term++; term != last; term++) value = term->inverse ? value-(*term)(x) : value+(*term)(x);
+            break;
+        case Operation::Multiply:
+            for (term++; term != last; term++) value = value*(*term)(x);
+            break;
+        case Operation::Min:
+            for (term++; term != last; term++) {
+                T current = (*term)(x);
+                if (current < value) value = current;
+            }
+            break;
+        case Operation::Max:
+            for (term++; term != last; term++) {
+                T current = (*term)(x);
+                if (value < current) value = current;
+            }
+            break;
+        default:
+            break;
+    }
+    return value;
+}
+
+#endif // SEGMENTNODE_HPP
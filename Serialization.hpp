@@ -0,0 +1,289 @@
+#ifndef SERIALIZATION_HPP
+#define SERIALIZATION_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include "Formula.hpp"
+#include "Expression.hpp"
+#include "sequences/DynamicArray.hpp"
+
+
+// Двоичный формат таблицы сегментов, все числа little-endian независимо от платформы:
+// заголовок - "SGFN", версия (u16), флаги (u16), число сегментов (u64); из флагов определён только
+// frozenFlag = 0x0001, остальные биты зарезервированы и должны быть нулевыми;
+// сегмент - start, end (f64), вид (u8), затем коэффициенты формулы (f64, их число зависит от вида)
+// или для выражения длина текста (u32) и сам текст.
+// С флагом frozenFlag все сегменты - записи по 56 байт (start, end, вид u64, a, b, c, d) без выражений:
+// поля выровнены по 8 байт, и таблицу можно использовать прямо из отображённого в память файла
+const char serializationMagic[4] = {'S', 'G', 'F', 'N'};
+const uint16_t serializationVersion = 1;
+const uint16_t frozenFlag = 0x0001;
+const uint8_t expressionTag = 0x80;
+const size_t serializationHeaderSize = 16;
+const size_t frozenRecordSize = 56;
+
+// Запись, прочитанная из потока: формула либо текст выражения
+struct SegmentRecord {
+    double start;
+    double end;
+    Formula formula;
+    bool expression;
+    std::string text;
+    SegmentRecord(): start(0), end(0), formula(), expression(false), text() {}
+};
+
+// Число хранимых коэффициентов формулы, 0 - вид не сохраняется
+inline size_t StoredCoefficients(FormulaKind kind) {
+    switch (kind) {
+        case FormulaKind::Constant: return 1;
+        case FormulaKind::Linear: return 2;
+        case FormulaKind::Quadratic: return 3;
+        case FormulaKind::Hyperbolic: return 3;
+        case FormulaKind::Power: return 1;
+        case FormulaKind::Sine: return 4;
+        default: return 0;
+    }
+}
+
+inline void StoreLittle(unsigned char *bytes, uint64_t value, size_t size) {
+    for (size_t i = 0; i < size; i++) bytes[i] = static_cast<unsigned char>(value >> 8*i);
+}
+
+inline uint64_t LoadLittle(const unsigned char *bytes, size_t size) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < size; i++) value |= uint64_t(bytes[i]) << 8*i;
+    return value;
+}
+
+// Потоковая запись: заголовок сразу, сегменты копятся в буфере и сбрасываются блоками;
+// число сегментов объявляется заранее, Finish проверяет, что все записаны
+class SegmentWriter {
+    private:
+        static const size_t bufferSize = 1 << 16;
+        std::ostream &out;
+        uint64_t expected;
+        uint64_t written;
+        bool frozen;
+        DynamicArray<unsigned char> buffer;
+        size_t used;
+        void Flush();
+        void Put(const void *data, size_t size);
+        void PutInteger(uint64_t value, size_t size);
+        void PutDouble(double value);
+        void Begin(double start, double end);
+    public:
+        // Создание объекта
+        SegmentWriter(std::ostream &out, uint64_t count, uint16_t flags = 0);
+        SegmentWriter(const SegmentWriter&) = delete;
+        SegmentWriter& operator=(const SegmentWriter&) = delete;
+
+        // Операции
+        void Write(double start, double end, const Formula &formula);
+        void Write(double start, double end, const Expression &expression);
+        void Finish();
+};
+
+// Потоковое чтение: заголовок проверяется в конструкторе, Next отдаёт записи по одной
+class SegmentReader {
+    private:
+        static const size_t bufferSize = 1 << 16;
+        std::istream &in;
+        uint64_t count;
+        uint64_t read;
+        uint16_t version;
+        uint16_t flags;
+        DynamicArray<unsigned char> buffer;
+        size_t position;
+        size_t available;
+        void Take(void *data, size_t size);
+        uint64_t TakeInteger(size_t size);
+        double TakeDouble();
+    public:
+        // Создание объекта
+        SegmentReader(std::istream &in);
+        SegmentReader(const SegmentReader&) = delete;
+        SegmentReader& operator=(const SegmentReader&) = delete;
+
+        // Декомпозиция
+        uint64_t GetCount() const;
+        uint16_t GetVersion() const;
+        uint16_t GetFlags() const;
+
+        // Операции
+        bool Next(SegmentRecord &record);
+};
+
+// Создание объекта
+inline SegmentWriter::SegmentWriter(std::ostream &out, uint64_t count, uint16_t flags):
+    out(out), expected(count), written(0), frozen(flags & frozenFlag), buffer(bufferSize), used(0) {
+    if (flags & ~frozenFlag) throw std::invalid_argument("Неизвестные флаги формата!");
+    Put(serializationMagic, sizeof(serializationMagic));
+    PutInteger(serializationVersion, 2);
+    PutInteger(flags, 2);
+    PutInteger(count, 8);
+}
+
+inline void SegmentWriter::Flush() {
+    if (used > 0) out.write(reinterpret_cast<const char*>(&buffer[0]), used);
+    used = 0;
+    if (!out) throw std::runtime_error("Ошибка записи!");
+}
+
+inline void SegmentWriter::Put(const void *data, size_t size) {
+    const unsigned char *bytes = static_cast<const unsigned char*>(data);
+    while (size > 0) {
+        if (used == bufferSize) Flush();
+        size_t part = std::min(size, bufferSize-used);
+        std::memcpy(&buffer[used], bytes, part);
+        used += part;
+        bytes += part;
+        size -= part;
+    }
+}
+
+inline void SegmentWriter::PutInteger(uint64_t value, size_t size) {
+    unsigned char bytes[8];
+    StoreLittle(bytes, value, size);
+    Put(bytes, size);
+}
+
+inline void SegmentWriter::PutDouble(double value) {
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    PutInteger(bits, 8);
+}
+
+inline void SegmentWriter::Begin(double start, double end) {
+    if (written == expected) throw std::runtime_error("Записано больше сегментов, чем объявлено!");
+    written++;
+    PutDouble(start);
+    PutDouble(end);
+}
+
+// Операции
+inline void SegmentWriter::Write(double start, double end, const Formula &formula) {
+    size_t coefficients = StoredCoefficients(formula.kind);
+    if (coefficients == 0) throw std::invalid_argument("Неизвестный вид функции!");
+    Begin(start, end);
+    PutInteger(static_cast<uint8_t>(formula.kind), frozen ? 8 : 1);
+    if (frozen) coefficients = 4;
+    const double values[4] = {formula.a, formula.b, formula.c, formula.d};
+    for (size_t i = 0; i < coefficients; i++) PutDouble(values[i]);
+}
+
+inline void SegmentWriter::Write(double start, double end, const Expression &expression) {
+    const std::string &text = expression.GetText();
+    if (frozen) throw std::invalid_argument("Выражение нельзя записать в замороженную таблицу!");
+    if (text.size() > UINT32_MAX) throw std::invalid_argument("Слишком длинное выражение!");
+    Begin(start, end);
+    PutInteger(expressionTag, 1);
+    PutInteger(text.size(), 4);
+    Put(text.data(), text.size());
+}
+
+inline void SegmentWriter::Finish() {
+    if (written != expected) throw std::runtime_error("Записано меньше сегментов, чем объявлено!");
+    Flush();
+    out.flush();
+    if (!out) throw std::runtime_error("Ошибка записи!");
+}
+
+// Создание объекта
+inline SegmentReader::SegmentReader(std::istream &in):
+    in(in), count(0), read(0), version(0), flags(0), buffer(bufferSize), position(0), available(0) {
+    char magic[4];
+    Take(magic, sizeof(magic));
+    if (std::memcmp(magic, serializationMagic, sizeof(magic)) != 0) throw std::runtime_error("Неизвестный формат файла!");
+    version = static_cast<uint16_t>(TakeInteger(2));
+    if (version == 0 || version > serializationVersion) throw std::runtime_error("Неподдерживаемая версия формата!");
+    flags = static_cast<uint16_t>(TakeInteger(2));
+    if (flags & ~frozenFlag) throw std::runtime_error("Неизвестные флаги формата!");
+    count = TakeInteger(8);
+}
+
+// Копирует size байт, дочитывая поток блоками по bufferSize
+inline void SegmentReader::Take(void *data, size_t size) {
+    unsigned char *bytes = static_cast<unsigned char*>(data);
+    while (size > 0) {
+        if (position == available) {
+            in.read(reinterpret_cast<char*>(&buffer[0]), bufferSize);
+            available = static_cast<size_t>(in.gcount());
+            position = 0;
+            if (available == 0) throw std::runtime_error("Неожиданный конец файла!");
+        }
+        size_t part = std::min(size, available-position);
+        std::memcpy(bytes, &buffer[position], part);
+        position += part;
+        bytes += part;
+        size -= part;
+    }
+}
+
+inline uint64_t SegmentReader::TakeInteger(size_t size) {
+    unsigned char bytes[8];
+    Take(bytes, size);
+    return LoadLittle(bytes, size);
+}
+
+inline double SegmentReader::TakeDouble() {
+    uint64_t bits = TakeInteger(8);
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+// Декомпозиция
+inline uint64_t SegmentReader::GetCount() const {
+    return count;
+}
+
+inline uint16_t SegmentReader::GetVersion() const {
+    return version;
+}
+
+inline uint16_t SegmentReader::GetFlags() const {
+    return flags;
+}
+
+// Операции
+// Текст выражения читается частями по bufferSize: длина из повреждённого файла не заставит
+// выделить гигабайты до того, как обнаружится конец потока
+inline bool SegmentReader::Next(SegmentRecord &record) {
+    if (read == count) return false;
+    record.start = TakeDouble();
+    record.end = TakeDouble();
+    uint64_t tag = TakeInteger(flags & frozenFlag ? 8 : 1);
+    if (tag == expressionTag && !(flags & frozenFlag)) {
+        record.expression = true;
+        record.formula = Formula();
+        uint64_t length = TakeInteger(4);
+        record.text.clear();
+        while (record.text.size() < length) {
+            size_t done = record.text.size(), part = static_cast<size_t>(std::min<uint64_t>(length-done, bufferSize));
+            record.text.resize(done+part);
+            Take(&record.text[done], part);
+        }
+    } else {
+        FormulaKind kind = tag <= static_cast<uint8_t>(FormulaKind::Sine) ? static_cast<FormulaKind>(tag) : FormulaKind::Opaque;
+        size_t coefficients = StoredCoefficients(kind);
+        if (coefficients == 0) throw std::runtime_error("Неизвестный вид сегмента!");
+        if (flags & frozenFlag) coefficients = 4;
+        double values[4] = {0, 0, 0, 0};
+        for (size_t i = 0; i < coefficients; i++) values[i] = TakeDouble();
+        record.expression = false;
+        record.formula.kind = kind;
+        record.formula.a = values[0];
+        record.formula.b = values[1];
+        record.formula.c = values[2];
+        record.formula.d = values[3];
+    }
+    read++;
+    return true;
+}
+
+#endif // SERIALIZATION_HPP
@@ -0,0 +1,126 @@
+#ifndef SPARSETABLE_HPP
+#define SPARSETABLE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include "sequences/Sequence.hpp"
+#include "sequences/DynamicArray.hpp"
+
+
+// Разреженная таблица минимумов и максимумов minValue/maxValue сегментов:
+// построение за O(n log n), запрос по отрезку индексов [left, right] за O(1)
+template <typename T>
+class SparseTable {
+    private:
+        DynamicArray<T> *minimums;
+        DynamicArray<T> *maximums;
+        DynamicArray<size_t> *logarithms;
+        size_t count;
+        size_t levels;
+        std::atomic<bool> built;
+        template <typename S>
+        void Fill(const Sequence<S> &segments);
+    public:
+        // Создание объекта
+        SparseTable();
+        ~SparseTable();
+        SparseTable(const SparseTable<T>&) = delete;
+        SparseTable<T>& operator=(const SparseTable<T>&) = delete;
+
+        // Декомпозиция
+        bool IsBuilt() const;
+
+        // Операции
+        template <typename S>
+        void Build(const Sequence<S> &segments);
+        void Invalidate();
+        T Min(size_t left, size_t right) const;
+        T Max(size_t left, size_t right) const;
+};
+
+// Создание объекта
+template <typename T>
+SparseTable<T>::SparseTable() {
+    minimums = nullptr;
+    maximums = nullptr;
+    logarithms = nullptr;
+    count = 0;
+    levels = 0;
+    built = false;
+}
+
+template <typename T>
+SparseTable<T>::~SparseTable() {
+    Invalidate();
+}
+
+// Декомпозиция
+template <typename T>
+bool SparseTable<T>::IsBuilt() const {
+    return built.load(std::memory_order_acquire);
+}
+
+// Операции
+template <typename T>
+template <typename S>
+void SparseTable<T>::Build(const Sequence<S> &segments) {
+    Invalidate();
+    Fill(segments);
+    built.store(true, std::memory_order_release);
+}
+
+template <typename T>
+template <typename S>
+void SparseTable<T>::Fill(const Sequence<S> &segments) {
+    count = segments.GetLength();
+    if (count == 0) return;
+    logarithms = new DynamicArray<size_t>(count+1);
+    (*logarithms)[0] = 0;
+    (*logarithms)[1] = 0;
+    for (size_t i = 2; i <= count; i++) (*logarithms)[i] = (*logarithms)[i/2]+1;
+    levels = (*logarithms)[count]+1;
+    minimums = new DynamicArray<T>(levels*count);
+    maximums = new DynamicArray<T>(levels*count);
+    for (size_t i = 0; i < count; i++) {
+        (*minimums)[i] = segments[i].minValue;
+        (*maximums)[i] = segments[i].maxValue;
+    }
+    for (size_t level = 1; level < levels; level++) {
+        size_t half = size_t(1) << (level-1), row = level*count, previous = (level-1)*count;
+        for (size_t i = 0; i+2*half <= count; i++) {
+            const T &a = (*minimums)[previous+i], &b = (*minimums)[previous+i+half];
+            (*minimums)[row+i] = b < a ? b : a;
+            const T &c = (*maximums)[previous+i], &d = (*maximums)[previous+i+half];
+            (*maximums)[row+i] = c < d ? d : c;
+        }
+    }
+}
+
+template <typename T>
+void SparseTable<T>::Invalidate() {
+    delete minimums;
+    delete maximums;
+    delete logarithms;
+    minimums = nullptr;
+    maximums = nullptr;
+    logarithms = nullptr;
+    count = 0;
+    levels = 0;
+    built = false;
+}
+
+template <typename T>
+T SparseTable<T>::Min(size_t left, size_t right) const {
+    size_t level = (*logarithms)[right-left+1], row = level*count;
+    const T &a = (*minimums)[row+left], &b = (*minimums)[row+right+1-(size_t(1) << level)];
+    return b < a ? b : a;
+}
+
+template <typename T>
+T SparseTable<T>::Max(size_t left, size_t right) const {
+    size_t level = (*logarithms)[right-left+1], row = level*count;
+    const T &a = (*maximums)[row+left], &b = (*maximums)[row+right+1-(size_t(1) << level)];
+    return a < b ? b : a;
+}
+
+#endif // SPARSETABLE_HPP
@@ -0,0 +1,35 @@
+#ifndef STATISTICS_HPP
+#define STATISTICS_HPP
+
+#include <cstddef>
+
+
+// Счётчики попаданий/промахов кэшей поиска и вычисления
+struct HitStatistics {
+    size_t hits;
+    size_t misses;
+    HitStatistics(): hits(0), misses(0) {}
+    size_t Total() const {
+        return hits+misses;
+    }
+    double HitRate() const {
+        return Total() == 0 ? 0.0 : static_cast<double>(hits)/Total();
+    }
+};
+
+// Число сегментов, убранных сжатием: слитых с соседом и обрезков не шире допуска
+struct CompactionStatistics {
+    size_t merged;
+    size_t slivers;
+    CompactionStatistics(): merged(0), slivers(0) {}
+    size_t Total() const {
+        return merged+slivers;
+    }
+    CompactionStatistics& operator+=(const CompactionStatistics &other) {
+        merged += other.merged;
+        slivers += other.slivers;
+        return *this;
+    }
+};
+
+#endif // STATISTICS_HPP
@@ -1,4 +1,4 @@
-QT       += core gui charts
+QT       += core gui charts concurrent
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
@@ -10,10 +10,13 @@ CONFIG += c++17
 
 SOURCES += \
     main.cpp \
-    mainwindow.cpp
+    mainwindow.cpp \
+    plotsampler.cpp
 
 HEADERS += \
-    mainwindow.h
+    chartview.h \
+    mainwindow.h \
+    plotsampler.h
 
 FORMS += \
     mainwindow.ui
@@ -0,0 +1,22 @@
+#ifndef CHARTVIEW_H
+#define CHARTVIEW_H
+
+#include <QElapsedTimer>
+#include <QtCharts>
+
+class TimedChartView : public QChartView {
+    Q_OBJECT
+public:
+    using QChartView::QChartView;
+signals:
+    void painted(qint64 nanoseconds);
+protected:
+    void paintEvent(QPaintEvent *event) override {
+        QElapsedTimer timer;
+        timer.start();
+        QChartView::paintEvent(event);
+        emit painted(timer.nsecsElapsed());
+    }
+};
+
+#endif // CHARTVIEW_H
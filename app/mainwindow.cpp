@@ -7,7 +7,17 @@ MainWindow::MainWindow(QWidget *parent):
     ui(new Ui::MainWindow),
     segmentFunction(new SegmentFunction<double>()),
     chart(new QChart()),
-    series(new QLineSeries())
+    series(new QLineSeries()),
+    tiles(maxCachedPoints),
+    plotWatcher(new QFutureWatcher<PlotBatch>(this)),
+    viewTimer(new QTimer(this)),
+    plotGeneration(0),
+    replotUpdated(0),
+    replotRemoved(0),
+    fitPending(false),
+    renderPending(false),
+    totalPoints(0),
+    seriesNanoseconds(0)
 {
     ui->setupUi(this);
     setStyleSheet(
@@ -107,11 +117,20 @@ MainWindow::MainWindow(QWidget *parent):
     connect(ui->pushButton_3, &QPushButton::clicked, this, &MainWindow::checkMonotonic);
     connect(ui->pushButton_4, &QPushButton::clicked, this, &MainWindow::checkContinuous);
     connect(ui->pushButton_5, &QPushButton::clicked, this, &MainWindow::clear);
+    connect(plotWatcher, &QFutureWatcher<PlotBatch>::resultReadyAt, this, &MainWindow::applySamples);
+    connect(plotWatcher, &QFutureWatcher<PlotBatch>::finished, this, [this]() {
+        if (!plotWatcher->isCanceled()) finishPlot();
+    });
+    viewTimer->setSingleShot(true);
+    viewTimer->setInterval(30);
+    connect(viewTimer, &QTimer::timeout, this, &MainWindow::updateView);
+    connect(qobject_cast<QValueAxis*>(chart->axisX()), &QValueAxis::rangeChanged, viewTimer, qOverload<>(&QTimer::start));
 }
 
 MainWindow::~MainWindow() {
+    plotWatcher->cancel();
+    plotWatcher->waitForFinished();
     delete segmentFunction;
-    delete series;
     delete chart;
     delete ui;
 }
@@ -133,7 +152,8 @@ void MainWindow::setupChart() {
     chart->setBackgroundRoundness(10);
     chart->setDropShadowEnabled(false);
 
-    QChartView *chartView = new QChartView(chart);
+    TimedChartView *chartView = new TimedChartView(chart);
+    connect(chartView, &TimedChartView::painted, this, &MainWindow::logRender);
     chartView->setRenderHint(QPainter::Antialiasing);
     chartView->setRubberBand(QChartView::RectangleRubberBand);
     chartView->setStyleSheet(
@@ -150,60 +170,230 @@ void MainWindow::setupChart() {
     delete oldItem;
     ui->gridLayout_6->addWidget(chartView);
     chartView->setContentsMargins(5, 5, 5, 5);
-    chart->setAnimationOptions(QChart::AllAnimations);
+    updateAnimations();
 }
 
 void MainWindow::updatePlot() {
-    chart->removeAllSeries();
-    double step = 0.01, minX = -10.0, maxX = 10.0, minY = -10.0, maxY = 10.0;
-    series = new QLineSeries();
-    bool flag = false;
-    for (int i = 0; i < segmentFunction->GetSize(); i++) {
-        for (double x = segmentFunction->Get(i).start; x < segmentFunction->Get(i).end; x+=step) {
-            try {
-                double y = segmentFunction->CalculateAt(x);
-                if (isfinite(y)) {
-                    series->append(x, y);
-                    if (flag) {
-                        if (y < minY) minY = y;
-                        if (y > maxY) maxY = y;
-                    } else {
-                        minY = maxY = y;
-                        flag = true;
-                    }
-                } else {
-                    if (series->count() > 0) {
-                        chart->addSeries(series);
-                        series = new QLineSeries();
-                    }
-                }
-            } catch (...) {
-                if (series->count() > 0) {
-                    chart->addSeries(series);
-                    series = new QLineSeries();
-                }
+    replot(true);
+}
+
+void MainWindow::updateView() {
+    replot(false);
+}
+
+void MainWindow::replot(bool fitY) {
+    replotTimer.start();
+    seriesNanoseconds = 0;
+    if (plotWatcher->isRunning()) plotWatcher->cancel();
+    plotGeneration++;
+    QValueAxis *axisX = qobject_cast<QValueAxis*>(chart->axisX());
+    QValueAxis *axisY = qobject_cast<QValueAxis*>(chart->axisY());
+    double minX = axisX->min(), maxX = axisX->max(), width = chart->plotArea().width();
+    if (fitY && fitYRange(minX, maxX)) fitPending = false;
+    else fitPending = fitPending || fitY;
+    int level = PlotSampler::tileLevel(minX, maxX, width);
+    QSet<size_t> alive;
+    QList<size_t> previews;
+    QList<TileRequest> requests;
+    replotUpdated = replotRemoved = 0;
+    for (size_t i = 0; i < segmentFunction->GetSize(); i++) {
+        Segment<double> segment = segmentFunction->Get(i);
+        if (segment.end < minX || maxX < segment.start) continue;
+        alive.insert(segment.id);
+        qint64 tileFrom = PlotSampler::tileOf(max(segment.start, minX), level);
+        qint64 tileTo = PlotSampler::tileOf(min(segment.end, maxX), level);
+        auto found = plots.find(segment.id);
+        bool changed = found == plots.end() || found->start != segment.start || found->end != segment.end;
+        if (!changed && found->fine && found->level == level && found->tileFrom == tileFrom && found->tileTo == tileTo) continue;
+        if (changed) {
+            if (found != plots.end()) removeSegmentPlot(*found);
+            SegmentPlot plot;
+            plot.start = segment.start;
+            plot.end = segment.end;
+            plot.minY = INFINITY;
+            plot.maxY = -INFINITY;
+            plot.points = 0;
+            found = plots.insert(segment.id, plot);
+        }
+        found->fine = false;
+        found->level = level;
+        found->tileFrom = tileFrom;
+        found->tileTo = tileTo;
+        replotUpdated++;
+        bool missing = false;
+        for (qint64 tile = tileFrom; tile <= tileTo; tile++) {
+            if (!tiles.contains(TileKey{segment.id, segment.start, segment.end, level, tile})) {
+                requests.append(TileRequest{i, level, tile});
+                missing = true;
             }
         }
-        chart->addSeries(series);
-        series = new QLineSeries();
+        if (!missing) showTiles(segment.id);
+        else if (found->series.isEmpty()) previews.append(i);
     }
-    delete series;
-    QList<QAbstractSeries*> seriesList = chart->series();
-    for (QAbstractSeries* s : seriesList) {
-        QLineSeries* ls = qobject_cast<QLineSeries*>(s);
-        if (ls) {
-            ls->attachAxis(chart->axisX());
-            ls->attachAxis(chart->axisY());
+    for (auto it = plots.begin(); it != plots.end();) {
+        if (alive.contains(it.key())) {
+            ++it;
+        } else {
+            removeSegmentPlot(*it);
+            it = plots.erase(it);
+            replotRemoved++;
         }
     }
-    if (flag) {
-        double yPadding = (maxY - minY) * 0.1;
-        minY -= yPadding;
-        maxY += yPadding;
+    if (previews.isEmpty() && requests.isEmpty()) {
+        finishPlot();
+        return;
     }
-    chart->axisX()->setRange(minX, maxX);
-    chart->axisY()->setRange(minY, maxY);
+    PlotJob job;
+    job.snapshot = make_shared<const ImmutableSegmentFunction<double>>(*segmentFunction);
+    job.previews = previews;
+    job.tiles = requests;
+    job.minX = minX;
+    job.maxX = maxX;
+    job.width = width;
+    job.yScale = axisY ? chart->plotArea().height()/(axisY->max()-axisY->min()) : 1.0;
+    job.generation = plotGeneration;
+    plotWatcher->setFuture(QtConcurrent::run(runPlotJob, job));
+}
+
+void MainWindow::applySamples(int index) {
+    PlotBatch batch = plotWatcher->resultAt(index);
+    for (const SegmentSamples &samples: batch.previews) {
+        if (samples.generation != plotGeneration) continue;
+        auto found = plots.find(samples.id);
+        if (found == plots.end() || found->fine || found->start != samples.start || found->end != samples.end) continue;
+        showPolylines(*found, samples.polylines);
+    }
+    QSet<size_t> touched;
+    for (const TileSamples &samples: batch.tiles) {
+        qsizetype cost = 1;
+        for (const QList<QPointF> &points: samples.polylines) cost += points.size();
+        tiles.insert(samples.key, new TileSamples(samples), cost);
+        touched.insert(samples.key.id);
+    }
+    for (size_t id: touched) showTiles(id);
+    updateAnimations();
+}
+
+void MainWindow::showTiles(size_t id) {
+    auto found = plots.find(id);
+    if (found == plots.end()) return;
+    QList<QList<QPointF>> polylines;
+    bool open = false;
+    for (qint64 tile = found->tileFrom; tile <= found->tileTo; tile++) {
+        TileSamples *samples = tiles.object(TileKey{id, found->start, found->end, found->level, tile});
+        if (!samples) return;
+        for (qsizetype i = 0; i < samples->polylines.size(); i++) {
+            if (i == 0 && open && samples->openStart && !polylines.isEmpty()) polylines.last().append(samples->polylines[0]);
+            else polylines.append(samples->polylines[i]);
+        }
+        open = samples->openEnd;
+    }
+    showPolylines(*found, polylines);
+    found->fine = true;
+}
+
+void MainWindow::showPolylines(SegmentPlot &plot, const QList<QList<QPointF>> &polylines) {
+    QElapsedTimer timer;
+    timer.start();
+    totalPoints -= plot.points;
+    plot.points = 0;
+    plot.minY = INFINITY;
+    plot.maxY = -INFINITY;
+    qsizetype used = 0;
+    for (const QList<QPointF> &points: polylines) {
+        QLineSeries *segmentSeries;
+        if (used < plot.series.size()) {
+            segmentSeries = plot.series[used];
+        } else {
+            segmentSeries = new QLineSeries();
+            segmentSeries->setUseOpenGL(true);
+            chart->addSeries(segmentSeries);
+            segmentSeries->attachAxis(chart->axisX());
+            segmentSeries->attachAxis(chart->axisY());
+            plot.series.append(segmentSeries);
+        }
+        segmentSeries->replace(points);
+        for (const QPointF &point: points) {
+            plot.minY = min(plot.minY, point.y());
+            plot.maxY = max(plot.maxY, point.y());
+        }
+        plot.points += points.size();
+        used++;
+    }
+    while (plot.series.size() > used) {
+        QLineSeries *segmentSeries = plot.series.takeLast();
+        chart->removeSeries(segmentSeries);
+        delete segmentSeries;
+    }
+    totalPoints += plot.points;
+    seriesNanoseconds += timer.nsecsElapsed();
+}
+
+void MainWindow::updateAnimations() {
+    chart->setAnimationOptions(totalPoints > animationPointLimit ? QChart::NoAnimation : QChart::AllAnimations);
+}
+
+void MainWindow::finishPlot() {
+    if (fitPending) {
+        double minY = -10.0, maxY = 10.0;
+        bool flag = false;
+        for (const SegmentPlot &plot: plots) {
+            if (plot.minY > plot.maxY) continue;
+            minY = flag ? min(minY, plot.minY) : plot.minY;
+            maxY = flag ? max(maxY, plot.maxY) : plot.maxY;
+            flag = true;
+        }
+        if (flag) setYRange(minY, maxY);
+        else chart->axisY()->setRange(minY, maxY);
+        fitPending = false;
+    }
+    updateAnimations();
     chart->update();
+    addLogMessage(QString("Перерисовка: %1 мс (обновлено %2, удалено %3, без изменений %4, плиток в кэше %5)")
+                      .arg(replotTimer.nsecsElapsed()/1e6, 0, 'f', 2)
+                      .arg(replotUpdated).arg(replotRemoved).arg(plots.size()-replotUpdated).arg(tiles.size()));
+    addLogMessage(QString("Обновление серий: %1 мс, точек на графике: %2")
+                      .arg(seriesNanoseconds/1e6, 0, 'f', 2).arg(totalPoints));
+    renderPending = true;
+}
+
+// Границы оси Y по точным экстремумам функции в видимом окне, без выборки точек;
+// false, если функция там не определена или не ограничена (тогда границы берутся по построенным точкам)
+bool MainWindow::fitYRange(double minX, double maxX) {
+    try {
+        double minY = segmentFunction->RangeMin(minX, maxX);
+        double maxY = segmentFunction->RangeMax(minX, maxX);
+        if (!isfinite(minY) || !isfinite(maxY)) return false;
+        setYRange(minY, maxY);
+        return true;
+    } catch (const std::exception&) {
+        return false;
+    }
+}
+
+void MainWindow::setYRange(double minY, double maxY) {
+    double yPadding = (maxY - minY) * 0.1;
+    minY -= yPadding;
+    maxY += yPadding;
+    if (minY == maxY) {
+        minY -= 1.0;
+        maxY += 1.0;
+    }
+    chart->axisY()->setRange(minY, maxY);
+}
+
+void MainWindow::logRender(qint64 nanoseconds) {
+    if (!renderPending) return;
+    renderPending = false;
+    addLogMessage(QString("Отрисовка: %1 мс").arg(nanoseconds/1e6, 0, 'f', 2));
+}
+
+void MainWindow::removeSegmentPlot(const SegmentPlot &plot) {
+    totalPoints -= plot.points;
+    for (QLineSeries *segmentSeries: plot.series) {
+        chart->removeSeries(segmentSeries);
+        delete segmentSeries;
+    }
 }
 
 void MainWindow::updateInfo() {
@@ -230,13 +420,11 @@ void MainWindow::defineSegment() {
             QMessageBox::warning(this, QString::fromStdString("Ошибка"), QString::fromStdString("Неправильные аргументы!"));
         } else {
             QString functionType = ui->comboBox->currentText();
-            function<double(double)> func;
             if (functionType == "Константная f(x)=c") {
                 bool ok;
                 double c = QInputDialog::getDouble(this, "Коэффициенты", "Введите значение константы c:", 0.0, -1e9, 1e9, 2, &ok);
                 if (ok) {
-                    func = [c](double){return c;};
-                    segmentFunction->Define(start, end, func);
+                    segmentFunction->Define(start, end, Formula::Constant(c));
                     updatePlot();
                     updateInfo();
                     addLogMessage(QString("Добавлен сегмент [%1, %2] с функцией: %3").arg(start).arg(end).arg(functionType));
@@ -246,8 +434,7 @@ void MainWindow::defineSegment() {
                 double a = QInputDialog::getDouble(this, "Коэффициенты", "Введите коэффициент a:", 1.0, -1e6, 1e6, 2, &ok1);
                 double b = QInputDialog::getDouble(this, "Коэффициенты", "Введите коэффициент b:", 0.0, -1e6, 1e6, 2, &ok2);
                 if (ok1 && ok2) {
-                    func = [a, b](double x){return a*x+b;};
-                    segmentFunction->Define(start, end, func);
+                    segmentFunction->Define(start, end, Formula::Linear(a, b));
                     updatePlot();
                     updateInfo();
                     addLogMessage(QString("Добавлен сегмент [%1, %2] с функцией: %3").arg(start).arg(end).arg(functionType));
@@ -258,8 +445,7 @@ void MainWindow::defineSegment() {
                 double b = QInputDialog::getDouble(this, "Коэффициенты", "Введите коэффициент b:", 0.0, -1e6, 1e6, 2, &ok2);
                 double c = QInputDialog::getDouble(this, "Коэффициенты", "Введите коэффициент c:", 0.0, -1e6, 1e6, 2, &ok3);
                 if (ok1 && ok2 && ok3) {
-                    func = [a, b, c](double x){return a*x*x+b*x+c;};
-                    segmentFunction->Define(start, end, func);
+                    segmentFunction->Define(start, end, Formula::Quadratic(a, b, c));
                     updatePlot();
                     updateInfo();
                     addLogMessage(QString("Добавлен сегмент [%1, %2] с функцией: %3").arg(start).arg(end).arg(functionType));
@@ -270,8 +456,7 @@ void MainWindow::defineSegment() {
                 double a = QInputDialog::getDouble(this, "Коэффициенты", "Введите коэффициент a:", 1.0, -1e6, 1e6, 2, &ok2);
                 double b = QInputDialog::getDouble(this, "Коэффициенты", "Введите коэффициент b:", 0.0, -1e6, 1e6, 2, &ok3);
                 if (ok1 && ok2 && ok3) {
-                    func = [k, a, b](double x){return k/(x+a)+b;};
-                    segmentFunction->Define(start, end, func);
+                    segmentFunction->Define(start, end, Formula::Hyperbolic(k, a, b));
                     updatePlot();
                     updateInfo();
                     addLogMessage(QString("Добавлен сегмент [%1, %2] с функцией: %3").arg(start).arg(end).arg(functionType));
@@ -280,8 +465,7 @@ void MainWindow::defineSegment() {
                 bool ok;
                 double n = QInputDialog::getDouble(this, "Коэффициенты", "Введите коэффициент n:", 1.0, -1e6, 1e6, 2, &ok);
                 if (ok) {
-                    func = [n](double x){return pow(x, n);};
-                    segmentFunction->Define(start, end, func);
+                    segmentFunction->Define(start, end, Formula::Power(n));
                     updatePlot();
                     updateInfo();
                     addLogMessage(QString("Добавлен сегмент [%1, %2] с функцией: %3").arg(start).arg(end).arg(functionType));
@@ -293,12 +477,20 @@ void MainWindow::defineSegment() {
                 double c = QInputDialog::getDouble(this, "Коэффициенты", "Введите фазу c:", 0.0, -6.28, 6.28, 2, &ok3);
                 double d = QInputDialog::getDouble(this, "Коэффициенты", "Введите смещение d:", 0.0, -1e6, 1e6, 2, &ok4);
                 if (ok1 && ok2 && ok3 && ok4) {
-                    func = [a, b, c, d](double x){return a*sin(b*x+c)+d;};
-                    segmentFunction->Define(start, end, func);
+                    segmentFunction->Define(start, end, Formula::Sine(a, b, c, d));
                     updatePlot();
                     updateInfo();
                     addLogMessage(QString("Добавлен сегмент [%1, %2] с функцией: %3").arg(start).arg(end).arg(functionType));
                 }
+            } else if (functionType == "Выражение f(x)=...") {
+                bool ok;
+                QString text = QInputDialog::getText(this, "Выражение", "Введите f(x), например sin(x)^2 + 0.5*x:", QLineEdit::Normal, "x", &ok);
+                if (ok) {
+                    segmentFunction->Define(start, end, Expression::Parse(text.toStdString()));
+                    updatePlot();
+                    updateInfo();
+                    addLogMessage(QString("Добавлен сегмент [%1, %2] с функцией: f(x)=%3").arg(start).arg(end).arg(text));
+                }
             }
         }
     } catch (const std::exception& e) {
@@ -307,13 +499,17 @@ void MainWindow::defineSegment() {
 }
 
 void MainWindow::calculateAt() {
-    try {
-        double x = ui->doubleSpinBox_3->value();
-        double result = segmentFunction->CalculateAt(x);
-        QString message = QString("f(%1) = %2").arg(x).arg(result);
-        addLogMessage(message);
-    } catch (const std::exception& e) {
-        QMessageBox::warning(this, "Ошибка", e.what());
+    double x = ui->doubleSpinBox_3->value(), result;
+    switch (segmentFunction->TryCalculateAt(x, result)) {
+        case EvaluationStatus::Defined:
+            addLogMessage(QString("f(%1) = %2").arg(x).arg(result));
+            break;
+        case EvaluationStatus::Discontinuity:
+            QMessageBox::warning(this, "Ошибка", QString("Критическая точка x = %1 (разрыв)").arg(x, 0, 'f', 2));
+            break;
+        case EvaluationStatus::Undefined:
+            QMessageBox::warning(this, "Ошибка", QString("Функция не определена в точке x = %1!").arg(x, 0, 'f', 2));
+            break;
     }
 }
 
@@ -5,9 +5,18 @@
 #include <QMessageBox>
 #include <QInputDialog>
 #include <QDateTime>
+#include <QElapsedTimer>
+#include <QFutureWatcher>
+#include <QtConcurrent>
+#include <QCache>
+#include <QHash>
+#include <QSet>
+#include <QTimer>
 #include <QtCharts>
 #include <QPropertyAnimation>
 #include "../SegmentFunction.hpp"
+#include "plotsampler.h"
+#include "chartview.h"
 using namespace std;
 
 QT_BEGIN_NAMESPACE
@@ -27,15 +36,53 @@ private slots:
     void clear();
 
     void updatePlot();
+    void updateView();
+    void applySamples(int index);
+    void finishPlot();
+    void logRender(qint64 nanoseconds);
     void updateInfo();
     void addLogMessage(const QString& message);
 private:
     Ui::MainWindow *ui;
     SegmentFunction<double> *segmentFunction;
 
+    struct SegmentPlot {
+        double start;
+        double end;
+        double minY;
+        double maxY;
+        bool fine;
+        int level;
+        qint64 tileFrom;
+        qint64 tileTo;
+        qsizetype points;
+        QList<QLineSeries*> series;
+    };
+    static const qsizetype maxCachedPoints = 4000000;
+    static const qsizetype animationPointLimit = 10000;
+
     QChart *chart;
     QLineSeries *series;
+    QHash<size_t, SegmentPlot> plots;
+    QCache<TileKey, TileSamples> tiles;
+    QFutureWatcher<PlotBatch> *plotWatcher;
+    QTimer *viewTimer;
+    quint64 plotGeneration;
+    QElapsedTimer replotTimer;
+    int replotUpdated;
+    int replotRemoved;
+    bool fitPending;
+    bool renderPending;
+    qsizetype totalPoints;
+    qint64 seriesNanoseconds;
     void setupChart();
+    void replot(bool fitY);
+    void showTiles(size_t id);
+    void showPolylines(SegmentPlot &plot, const QList<QList<QPointF>> &polylines);
+    void updateAnimations();
+    bool fitYRange(double minX, double maxX);
+    void setYRange(double minY, double maxY);
+    void removeSegmentPlot(const SegmentPlot &plot);
 };
 
 #endif // MAINWINDOW_H
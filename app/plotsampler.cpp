@@ -0,0 +1,173 @@
+#include "plotsampler.h"
+#include <QElapsedTimer>
+#include <cmath>
+
+namespace {
+const double cellPixels = 8.0;
+const double tolerancePixels = 0.5;
+const int maxDepth = 12;
+const double coarseFactor = 8.0;
+const qint64 frameMilliseconds = 16;
+const int tilePixels = 256;
+const int samplesPerPixel = 4;
+
+// M4: в каждом столбце пикселей остаются первая, минимальная, максимальная и последняя точки
+class M4Column {
+public:
+    M4Column(): count(0) {}
+    void add(QPointF point) {
+        if (count == 0) first = low = high = point;
+        if (point.y() < low.y()) low = point;
+        if (point.y() > high.y()) high = point;
+        last = point;
+        count++;
+    }
+    void flush(QList<QPointF> &polyline) {
+        if (count == 0) return;
+        QPointF points[4] = {first, low.x() < high.x() ? low : high, low.x() < high.x() ? high : low, last};
+        for (const QPointF &point: points) {
+            if (polyline.isEmpty() || polyline.last() != point) polyline.append(point);
+        }
+        count = 0;
+    }
+private:
+    QPointF first, low, high, last;
+    int count;
+};
+}
+
+bool TileKey::operator==(const TileKey &other) const {
+    return id == other.id && start == other.start && end == other.end && level == other.level && tile == other.tile;
+}
+
+size_t qHash(const TileKey &key, size_t seed) {
+    return qHashMulti(seed, key.id, key.start, key.end, key.level, key.tile);
+}
+
+PlotSampler::PlotSampler(double minX, double maxX, double width, double yScale):
+    minX(minX),
+    maxX(maxX),
+    xScale(width > 0 && maxX > minX ? width/(maxX-minX) : 1.0),
+    yScale(yScale > 0 && isfinite(yScale) ? yScale : 1.0)
+{}
+
+QList<QList<QPointF>> PlotSampler::sample(const function<double(double)> &func, double start, double end) const {
+    QList<QList<QPointF>> polylines;
+    double from = max(start, minX), to = min(end, maxX);
+    if (from >= to) return polylines;
+    polylines.append(QList<QPointF>());
+    int cells = max(1, static_cast<int>(ceil((to-from)*xScale/cellPixels)));
+    QPointF previous(from, func(from));
+    push(previous, polylines);
+    for (int i = 1; i <= cells; i++) {
+        double x = i == cells ? to : from+(to-from)*i/cells;
+        QPointF next(x, func(x));
+        refine(func, previous, next, 0, polylines);
+        previous = next;
+    }
+    if (polylines.last().isEmpty()) polylines.removeLast();
+    return polylines;
+}
+
+int PlotSampler::tileLevel(double minX, double maxX, double width) {
+    return static_cast<int>(floor(log2((maxX-minX)/max(width, 1.0))));
+}
+
+double PlotSampler::tileWidth(int level) {
+    return tilePixels*ldexp(1.0, level);
+}
+
+qint64 PlotSampler::tileOf(double x, int level) {
+    return static_cast<qint64>(floor(x/tileWidth(level)));
+}
+
+TileSamples PlotSampler::sampleTile(const function<double(double)> &func, const TileKey &key) {
+    TileSamples samples;
+    samples.key = key;
+    samples.polylines.append(QList<QPointF>());
+    double pixel = ldexp(1.0, key.level), left = key.tile*tileWidth(key.level);
+    double from = max(left, key.start), to = min(left+tileWidth(key.level), key.end);
+    samples.openStart = samples.openEnd = false;
+    bool first = true;
+    for (int column = 0; column < tilePixels; column++) {
+        double a = max(left+column*pixel, from), b = min(left+(column+1)*pixel, to);
+        if (a > b) continue;
+        M4Column m4;
+        for (int i = 0; i < samplesPerPixel; i++) {
+            double x = a+(b-a)*i/(samplesPerPixel-1);
+            double y = func(x);
+            if (isfinite(y)) {
+                m4.add(QPointF(x, y));
+            } else {
+                m4.flush(samples.polylines.last());
+                if (!samples.polylines.last().isEmpty()) samples.polylines.append(QList<QPointF>());
+            }
+            if (first) samples.openStart = isfinite(y);
+            samples.openEnd = isfinite(y);
+            first = false;
+        }
+        m4.flush(samples.polylines.last());
+    }
+    if (samples.polylines.last().isEmpty()) samples.polylines.removeLast();
+    return samples;
+}
+
+void PlotSampler::refine(const function<double(double)> &func, QPointF a, QPointF b, int depth, QList<QList<QPointF>> &polylines) const {
+    bool split = false;
+    QPointF middle((a.x()+b.x())/2, 0);
+    if (depth < maxDepth && (b.x()-a.x())*xScale > 1.0) {
+        middle.setY(func(middle.x()));
+        bool finiteA = isfinite(a.y()), finiteB = isfinite(b.y()), finiteM = isfinite(middle.y());
+        if (finiteA != finiteB || finiteA != finiteM) split = true;
+        else if (finiteA) split = abs(middle.y()-(a.y()+b.y())/2)*yScale > tolerancePixels;
+    }
+    if (split) {
+        refine(func, a, middle, depth+1, polylines);
+        refine(func, middle, b, depth+1, polylines);
+    } else {
+        push(b, polylines);
+    }
+}
+
+void PlotSampler::push(QPointF point, QList<QList<QPointF>> &polylines) {
+    if (isfinite(point.y())) {
+        polylines.last().append(point);
+    } else if (!polylines.last().isEmpty()) {
+        polylines.append(QList<QPointF>());
+    }
+}
+
+void runPlotJob(QPromise<PlotBatch> &promise, const PlotJob &job) {
+    PlotSampler coarse(job.minX, job.maxX, job.width/coarseFactor, job.yScale/coarseFactor);
+    PlotBatch batch;
+    QElapsedTimer frame;
+    frame.start();
+    auto flush = [&](bool force) {
+        if ((force || frame.elapsed() >= frameMilliseconds) && (!batch.previews.isEmpty() || !batch.tiles.isEmpty())) {
+            promise.addResult(batch);
+            batch = PlotBatch();
+            frame.restart();
+        }
+    };
+    for (size_t index: job.previews) {
+        if (promise.isCanceled()) return;
+        Segment<double> segment = job.snapshot->Get(index);
+        SegmentSamples samples;
+        samples.id = segment.id;
+        samples.start = segment.start;
+        samples.end = segment.end;
+        samples.generation = job.generation;
+        samples.polylines = coarse.sample(segment.func, segment.start, segment.end);
+        batch.previews.append(samples);
+        flush(false);
+    }
+    flush(true);
+    for (const TileRequest &request: job.tiles) {
+        if (promise.isCanceled()) return;
+        Segment<double> segment = job.snapshot->Get(request.index);
+        TileKey key = {segment.id, segment.start, segment.end, request.level, request.tile};
+        batch.tiles.append(PlotSampler::sampleTile(segment.func, key));
+        flush(false);
+    }
+    flush(true);
+}
@@ -0,0 +1,79 @@
+#ifndef PLOTSAMPLER_H
+#define PLOTSAMPLER_H
+
+#include <QHash>
+#include <QList>
+#include <QPointF>
+#include <QPromise>
+#include <functional>
+#include <memory>
+#include "../SegmentFunction.hpp"
+using namespace std;
+
+struct SegmentSamples {
+    size_t id;
+    double start;
+    double end;
+    quint64 generation;
+    QList<QList<QPointF>> polylines;
+};
+
+struct TileKey {
+    size_t id;
+    double start;
+    double end;
+    int level;
+    qint64 tile;
+    bool operator==(const TileKey &other) const;
+};
+size_t qHash(const TileKey &key, size_t seed = 0);
+
+struct TileSamples {
+    TileKey key;
+    QList<QList<QPointF>> polylines;
+    bool openStart;
+    bool openEnd;
+};
+
+struct TileRequest {
+    size_t index;
+    int level;
+    qint64 tile;
+};
+
+struct PlotBatch {
+    QList<SegmentSamples> previews;
+    QList<TileSamples> tiles;
+};
+
+struct PlotJob {
+    shared_ptr<const ImmutableSegmentFunction<double>> snapshot;
+    QList<size_t> previews;
+    QList<TileRequest> tiles;
+    double minX;
+    double maxX;
+    double width;
+    double yScale;
+    quint64 generation;
+};
+
+class PlotSampler {
+public:
+    PlotSampler(double minX, double maxX, double width, double yScale);
+    QList<QList<QPointF>> sample(const function<double(double)> &func, double start, double end) const;
+    static TileSamples sampleTile(const function<double(double)> &func, const TileKey &key);
+    static int tileLevel(double minX, double maxX, double width);
+    static double tileWidth(int level);
+    static qint64 tileOf(double x, int level);
+private:
+    double minX;
+    double maxX;
+    double xScale;
+    double yScale;
+    void refine(const function<double(double)> &func, QPointF a, QPointF b, int depth, QList<QList<QPointF>> &polylines) const;
+    static void push(QPointF point, QList<QList<QPointF>> &polylines);
+};
+
+void runPlotJob(QPromise<PlotBatch> &promise, const PlotJob &job);
+
+#endif // PLOTSAMPLER_H
@@ -0,0 +1,9 @@
+#include <windows.h>
+#include "benchmarks/benchmark.hpp"
+
+
+int main(void) {
+    SetConsoleOutputCP(65001);
+    run_benchmarks();
+    return 0;
+}
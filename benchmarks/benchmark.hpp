@@ -0,0 +1,512 @@
+#ifndef BENCHMARK_HPP
+#define BENCHMARK_HPP
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include "../SegmentFunction.hpp"
+#include "../MappedSegmentFunction.hpp"
+
+
+double Elapsed(chrono::steady_clock::time_point start) {
+    return chrono::duration<double, milli>(chrono::steady_clock::now()-start).count();
+}
+
+// Вычисление на функции с большим числом разрывов
+void bench_gaps(void) {
+    const int segmentsCount = 2000, pointsCount = 1000000;
+    SegmentFunction<double> segFunc;
+    for (int i = 0; i < segmentsCount; i++) {
+        segFunc.Define(2*i, 2*i+1, [](double x) {return x;});
+    }
+    double step = 2.0*segmentsCount/pointsCount, sum = 0;
+    size_t defined = 0;
+
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < pointsCount; i++) {
+        try {
+            sum += segFunc.CalculateAt(i*step);
+        } catch (...) {}
+    }
+    double exceptions = Elapsed(start);
+
+    start = chrono::steady_clock::now();
+    for (int i = 0; i < pointsCount; i++) {
+        double value;
+        if (segFunc.TryCalculateAt(i*step, value) == EvaluationStatus::Defined) {
+            sum += value;
+            defined++;
+        }
+    }
+    double statuses = Elapsed(start);
+
+    cout << "gaps: " << pointsCount << " точек, определено " << defined << endl;
+    cout << "    CalculateAt + catch: " << exceptions << " мс" << endl;
+    cout << "    TryCalculateAt:      " << statuses << " мс (x" << exceptions/statuses << ")" << endl;
+    if (sum == 0) cout << endl;
+}
+
+// Анализ свойств функции с дорогими сегментами: один поток против нескольких
+void bench_analysis(void) {
+    const int segmentsCount = 20000, work = 50;
+    SegmentFunction<double> segFunc;
+    for (int i = 0; i < segmentsCount; i++) {
+        segFunc.Define(i, i+1, [](double x) {
+            double y = x;
+            for (int k = 0; k < work; k++) y = sin(y)+x;
+            return y;
+        });
+    }
+    SegmentFunction<double> copy(segFunc);
+
+    auto start = chrono::steady_clock::now();
+    double low = segFunc.Get(0).startValue, high = low;
+    for (size_t i = 0; i < segFunc.GetSize(); i++) {
+        Segment<double> segment = segFunc.Get(i);
+        for (size_t k = 0; k <= segFunc.GetMonotonicSamples(); k++) {
+            double y = segment.func(segment.start+(segment.end-segment.start)*k/segFunc.GetMonotonicSamples());
+            low = min(low, y);
+            high = max(high, y);
+        }
+    }
+    double serial = Elapsed(start);
+
+    start = chrono::steady_clock::now();
+    FunctionAnalysis<double> analysis = copy.AnalyzeAll();
+    double parallel = Elapsed(start);
+
+    start = chrono::steady_clock::now();
+    bool monotonic = copy.IsMonotonic();
+    double cached = Elapsed(start);
+
+    cout << "analysis: " << segmentsCount << " сегментов, потоков " << ParallelThreads(segmentsCount, 256) << endl;
+    cout << "    один поток:  " << serial << " мс, min " << low << ", max " << high << endl;
+    cout << "    AnalyzeAll:  " << parallel << " мс (x" << serial/parallel << "), min " << analysis.min << ", max " << analysis.max << endl;
+    cout << "    IsMonotonic: " << cached << " мс после анализа (" << (monotonic ? "монотонна" : "не монотонна") << ")" << endl;
+}
+
+// Интеграл по большой области: Integrate против суммы по средним точкам через CalculateAt
+void bench_integrate(void) {
+    const int segmentsCount = 10000, pointsCount = 1000000;
+    SegmentFunction<double> opaque, formulas;
+    for (int i = 0; i < segmentsCount; i++) {
+        opaque.Define(i, i+1, [](double x) {return sin(x)+x/1000;});
+        formulas.Define(i, i+1, Formula::Sine(1, 1, 0, 0));
+    }
+    double exact = 1-cos(segmentsCount*1.0)+0.5*segmentsCount*segmentsCount/1000.0;
+
+    auto start = chrono::steady_clock::now();
+    double step = 1.0*segmentsCount/pointsCount, naive = 0;
+    for (int i = 0; i < pointsCount; i++) naive += opaque.CalculateAt((i+0.5)*step)*step;
+    double sampling = Elapsed(start);
+
+    start = chrono::steady_clock::now();
+    IntegrationResult adaptive = opaque.Integrate(0, segmentsCount);
+    double quadrature = Elapsed(start);
+
+    start = chrono::steady_clock::now();
+    IntegrationResult closed = formulas.Integrate(0, segmentsCount);
+    double antiderivative = Elapsed(start);
+
+    cout << "integrate: " << segmentsCount << " сегментов" << endl;
+    cout << "    средние точки (" << pointsCount << "): " << sampling << " мс, ошибка " << abs(naive-exact) << endl;
+    cout << "    Integrate, G7-K15:  " << quadrature << " мс (x" << sampling/quadrature << "), ошибка "
+         << abs(adaptive.value-exact) << ", оценка " << adaptive.error << endl;
+    cout << "    Integrate, формулы: " << antiderivative << " мс, ошибка " << abs(closed.value-(1-cos(segmentsCount*1.0))) << endl;
+}
+
+// Много интегралов по разным окнам одной функции: без индекса и с префиксными суммами
+void bench_integral_index(void) {
+    const int segmentsCount = 10000, queriesCount = 1000;
+    SegmentFunction<double> segFunc;
+    for (int i = 0; i < segmentsCount; i++) segFunc.Define(i, i+1, [](double x) {return sin(x)+x/1000;});
+    double sum = 0;
+
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < queriesCount; i++) sum += segFunc.Integrate(i*3.7, segmentsCount-i*4.1).value;
+    double direct = Elapsed(start);
+
+    start = chrono::steady_clock::now();
+    segFunc.EnableIntegralIndex();
+    segFunc.Integrate(0, segmentsCount);
+    double build = Elapsed(start);
+
+    start = chrono::steady_clock::now();
+    for (int i = 0; i < queriesCount; i++) sum -= segFunc.Integrate(i*3.7, segmentsCount-i*4.1).value;
+    double indexed = Elapsed(start);
+
+    cout << "integral index: " << queriesCount << " окон на " << segmentsCount << " сегментах" << endl;
+    cout << "    без индекса:  " << direct << " мс" << endl;
+    cout << "    построение:   " << build << " мс" << endl;
+    cout << "    с индексом:   " << indexed << " мс (x" << direct/indexed << "), расхождение " << abs(sum) << endl;
+}
+
+// Обратное вычисление на монотонной функции: бисекция через CalculateAt против TrySolve
+void bench_solve(void) {
+    const int segmentsCount = 10000, valuesCount = 100000;
+    SegmentFunction<double> segFunc;
+    for (int i = 0; i < segmentsCount; i++) {
+        if (i%2 == 0) segFunc.Define(i, i+1, Formula::Quadratic(1, 0, 0));
+        else segFunc.Define(i, i+1, [](double x) {return x*x+sin(x)-sin(x);});
+    }
+    double top = 1.0*segmentsCount*segmentsCount, sum = 0;
+
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < valuesCount; i++) {
+        double y = top*i/valuesCount, left = 0, right = segmentsCount;
+        while (right-left > 1e-12*right) {
+            double middle = (left+right)/2;
+            if (segFunc.CalculateAt(middle) < y) left = middle;
+            else right = middle;
+        }
+        sum += left;
+    }
+    double bisection = Elapsed(start);
+
+    double *ys = new double[valuesCount], *xs = new double[valuesCount];
+    EvaluationStatus *statuses = new EvaluationStatus[valuesCount];
+    for (int i = 0; i < valuesCount; i++) ys[i] = top*i/valuesCount;
+    start = chrono::steady_clock::now();
+    size_t solved = segFunc.TrySolve(ys, valuesCount, xs, statuses);
+    double batch = Elapsed(start);
+    for (int i = 0; i < valuesCount; i++) sum -= xs[i];
+
+    cout << "solve: " << valuesCount << " значений на " << segmentsCount << " сегментах, решено " << solved << endl;
+    cout << "    бисекция через CalculateAt: " << bisection << " мс" << endl;
+    cout << "    TrySolve (пакет):           " << batch << " мс (x" << bisection/batch << "), расхождение " << abs(sum)/valuesCount << endl;
+    delete[] ys;
+    delete[] xs;
+    delete[] statuses;
+}
+
+// Вычисление по исходным функциям сегментов против скомпилированных чебышёвских приближений
+void bench_compile(void) {
+    const int segmentsCount = 10000, pointsCount = 1000000;
+    SegmentFunction<double> segFunc;
+    for (int i = 0; i < segmentsCount; i++) {
+        segFunc.Define(i, i+1, [](double x) {return exp(sin(x))*cos(x/3)/(1+log1p(x));});
+    }
+
+    auto start = chrono::steady_clock::now();
+    CompilationReport report;
+    SegmentFunction<double> compiled = segFunc.Compile(1e-9, &report);
+    double compilation = Elapsed(start);
+
+    double step = 1.0*segmentsCount/pointsCount, sum = 0, error = 0;
+    start = chrono::steady_clock::now();
+    for (int i = 0; i < pointsCount; i++) sum += segFunc((i+0.5)*step);
+    double original = Elapsed(start);
+
+    start = chrono::steady_clock::now();
+    for (int i = 0; i < pointsCount; i++) sum -= compiled((i+0.5)*step);
+    double chebyshev = Elapsed(start);
+
+    const int perSegment = pointsCount/segmentsCount;
+    start = chrono::steady_clock::now();
+    for (int i = 0; i < segmentsCount; i++) {
+        Segment<double> segment = segFunc.Get(i);
+        for (int k = 0; k < perSegment; k++) sum += segment.func(i+(k+0.5)/perSegment);
+    }
+    double originalDirect = Elapsed(start);
+
+    start = chrono::steady_clock::now();
+    for (int i = 0; i < segmentsCount; i++) {
+        Segment<double> segment = compiled.Get(i);
+        for (int k = 0; k < perSegment; k++) sum -= segment.func(i+(k+0.5)/perSegment);
+    }
+    double chebyshevDirect = Elapsed(start);
+
+    for (int i = 0; i < pointsCount; i += 97) error = max(error, abs(segFunc((i+0.5)*step)-compiled((i+0.5)*step)));
+    cout << "compile: " << segmentsCount << " сегментов, " << report.pieces << " кусков, " << report.bytes/1024 << " КиБ, компиляция "
+         << compilation << " мс" << endl;
+    cout << "    ошибка: " << report.maxError << " (контроль), " << error << " (выборка)" << endl;
+    cout << "    через CalculateAt: исходные " << original << " мс, Чебышёв " << chebyshev << " мс (x" << original/chebyshev << ")" << endl;
+    cout << "    функции сегментов: исходные " << originalDirect << " мс, Чебышёв " << chebyshevDirect
+         << " мс (x" << originalDirect/chebyshevDirect << ")" << endl;
+    if (sum == 0) cout << endl;
+}
+
+// Вычисление в случайных точках до и после слияния одинаковых соседних сегментов
+void bench_compact(void) {
+    const int segmentsCount = 10000, runLength = 25, pointsCount = 1000000;
+    SegmentFunction<double> segFunc;
+    for (int i = 0; i < segmentsCount; i++) {
+        int run = i/runLength;
+        segFunc.Define(i, i+1, Formula::Linear(run%2 == 0 ? 1 : -1, run%2 == 0 ? -run*runLength : (run+1)*runLength));
+    }
+    DynamicArray<double> xs(pointsCount);
+    unsigned long long state = 1;
+    for (int i = 0; i < pointsCount; i++) {
+        state = state*6364136223846793005ULL+1442695040888963407ULL;
+        xs[i] = (state >> 11)*0x1.0p-53*segmentsCount;
+    }
+
+    double sum = 0;
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < pointsCount; i++) sum += segFunc(xs[i]);
+    double before = Elapsed(start);
+
+    start = chrono::steady_clock::now();
+    CompactionStatistics statistics = segFunc.Compact();
+    double compaction = Elapsed(start);
+
+    start = chrono::steady_clock::now();
+    for (int i = 0; i < pointsCount; i++) sum -= segFunc(xs[i]);
+    double after = Elapsed(start);
+
+    cout << "compact: " << segmentsCount << " -> " << segFunc.GetSize() << " сегментов (слито " << statistics.merged
+         << "), сжатие " << compaction << " мс" << endl;
+    cout << "    вычисление: до " << before << " мс, после " << after << " мс (x" << before/after << ")" << endl;
+    if (sum == 0) cout << endl;
+}
+
+// Сумма двух кусочных функций: Zip + Map против operator+ (формулы складываются символьно)
+void bench_algebra(void) {
+    const int segmentsCount = 1000, pointsCount = 1000000;
+    SegmentFunction<double> tariff, usage;
+    for (int i = 0; i < segmentsCount; i++) {
+        tariff.Define(i, i+1, Formula::Linear(0.5, i));
+        usage.Define(i+0.5, i+1.5, Formula::Quadratic(0.01, 1, 0));
+    }
+
+    auto start = chrono::steady_clock::now();
+    auto zip = tariff.Zip(usage);
+    SegmentFunction<double> zipped = zip.Map<double>([](Segment<pair<double, double>> segment) {
+        return Segment<double>(segment.start, segment.end, [segment](double x) {
+            pair<double, double> values = segment.func(x);
+            return values.first+values.second;
+        });
+    });
+    double zipTime = Elapsed(start);
+
+    start = chrono::steady_clock::now();
+    SegmentFunction<double> sum = tariff+usage;
+    double sumTime = Elapsed(start);
+
+    DynamicArray<double> xs(pointsCount);
+    for (int i = 0; i < pointsCount; i++) xs[i] = 1+(i*7919LL)%(segmentsCount-2)+0.25+0.02*(i%10);
+    double total = 0, error = 0;
+    start = chrono::steady_clock::now();
+    for (int i = 0; i < pointsCount; i++) total += zipped(xs[i]);
+    double zipEvaluation = Elapsed(start);
+
+    start = chrono::steady_clock::now();
+    for (int i = 0; i < pointsCount; i++) total -= sum(xs[i]);
+    double sumEvaluation = Elapsed(start);
+
+    for (int i = 0; i < pointsCount; i += 101) error = max(error, abs(zipped(xs[i])-sum(xs[i])));
+    cout << "algebra: " << sum.GetSize() << " сегментов, построение: Zip+Map " << zipTime << " мс, operator+ " << sumTime
+         << " мс (x" << zipTime/sumTime << ")" << endl;
+    cout << "    вычисление: Zip+Map " << zipEvaluation << " мс, operator+ " << sumEvaluation << " мс (x"
+         << zipEvaluation/sumEvaluation << "), расхождение " << error << endl;
+    if (total == 0) cout << endl;
+}
+
+// Сумма восьми функций и Unzip(Zip(f, g)): вложенные замыкания против плоских цепочек
+void bench_flatten(void) {
+    const int termsCount = 8, pointsCount = 1000000;
+    SegmentFunction<double> terms[termsCount];
+    for (int k = 0; k < termsCount; k++) terms[k].Define(0.0, 1.0, [k](double x) {return x*(k+1);});
+    function<double(double)> nested = terms[0].Get(0).func;
+    for (int k = 1; k < termsCount; k++) {
+        function<double(double)> term = terms[k].Get(0).func;
+        nested = [nested, term](double x) {return nested(x)+term(x);};
+    }
+    SegmentFunction<double> flat = terms[0];
+    for (int k = 1; k < termsCount; k++) flat = flat+terms[k];
+    function<double(double)> chain = flat.Get(0).func;
+
+    function<double(double)> original = terms[0].Get(0).func, other = terms[1].Get(0).func;
+    function<pair<double, double>(double)> zipped = [original, other](double x) {return make_pair(original(x), other(x));};
+    function<double(double)> wrapped = [zipped](double x) {return zipped(x).first;};
+    auto zip = terms[0].Zip(terms[1]);
+    function<double(double)> unwrapped = SegmentFunction<double>::Unzip(zip).first.Get(0).func;
+
+    double step = 1.0/pointsCount, sum = 0;
+    auto measure = [&](const function<double(double)> &func) {
+        auto start = chrono::steady_clock::now();
+        for (int i = 0; i < pointsCount; i++) sum += func(i*step);
+        return Elapsed(start);
+    };
+    double nestedTime = measure(nested), chainTime = measure(chain);
+    double wrappedTime = measure(wrapped), unwrappedTime = measure(unwrapped);
+    cout << "flatten: сумма " << termsCount << " функций: вложенные " << nestedTime << " мс, цепочка " << chainTime
+         << " мс (x" << nestedTime/chainTime << ")" << endl;
+    cout << "    Unzip(Zip(f, g)).first: обёртки " << wrappedTime << " мс, f " << unwrappedTime << " мс (x"
+         << wrappedTime/unwrappedTime << ")" << endl;
+    if (sum == 0) cout << endl;
+}
+
+// Выражение из строки: байткод по одной точке и блоками против лямбды
+void bench_expression(void) {
+    const int pointsCount = 1000000;
+    function<double(double)> native = [](double x) {return exp(sin(x))*cos(x/3)/(1+log(1+x))+0.5*x*x-3*x;};
+    Expression expression = Expression::Parse("exp(sin(x))*cos(x/3)/(1+log(1+x)) + 0.5*x^2 - 3*x");
+    DynamicArray<double> xs(pointsCount), ys(pointsCount);
+    for (int i = 0; i < pointsCount; i++) xs[i] = 10.0*(i+0.5)/pointsCount;
+
+    double sum = 0;
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < pointsCount; i++) sum += native(xs[i]);
+    double nativeTime = Elapsed(start);
+
+    start = chrono::steady_clock::now();
+    for (int i = 0; i < pointsCount; i++) sum -= expression(xs[i]);
+    double scalarTime = Elapsed(start);
+
+    start = chrono::steady_clock::now();
+    expression.Evaluate(&xs[0], pointsCount, &ys[0]);
+    double vectorTime = Elapsed(start);
+
+    SegmentFunction<double> segFunc;
+    for (int i = 0; i < 10; i++) segFunc.Define(i, i+1, expression);
+    DynamicArray<EvaluationStatus> statuses(pointsCount);
+    start = chrono::steady_clock::now();
+    size_t defined = segFunc.TryCalculateAt(&xs[0], pointsCount, &ys[0], &statuses[0]);
+    double batchTime = Elapsed(start);
+
+    cout << "expression: " << expression.GetInstructions() << " команд, " << expression.GetRegisters() << " регистров" << endl;
+    cout << "    лямбда " << nativeTime << " мс, байткод по точке " << scalarTime << " мс (x" << scalarTime/nativeTime
+         << "), блоками " << vectorTime << " мс (x" << vectorTime/nativeTime << ")" << endl;
+    cout << "    пакетный TryCalculateAt: " << batchTime << " мс, определено " << defined << endl;
+    if (sum == 0) cout << endl;
+}
+
+// Запись и загрузка таблицы из 10^6 сегментов
+void bench_serialization(void) {
+    const int segmentsCount = 1000000, definedCount = 5000;
+    auto formulaAt = [](int i) {
+        switch (i % 3) {
+            case 0: return Formula::Linear(0.5, i);
+            case 1: return Formula::Quadratic(-1.0, 2.0*i, 0.25);
+            default: return Formula::Sine(1.0, 3.0, 0.1*i, i);
+        }
+    };
+
+    // Define дописывает сегмент копированием всего массива, поэтому для сравнения строится только 5000 сегментов
+    auto start = chrono::steady_clock::now();
+    SegmentFunction<double> small;
+    for (int i = 0; i < definedCount; i++) small.Define(i, i+1, formulaAt(i));
+    double defineTime = Elapsed(start);
+
+    DynamicArray<Segment<double>> items(segmentsCount);
+    for (int i = 0; i < segmentsCount; i++) {
+        Formula formula = formulaAt(i);
+        items[i] = Segment<double>(i, i+1, [formula](double x) {return formula(x);}, formula);
+    }
+    SegmentFunction<double> segFunc;
+    start = chrono::steady_clock::now();
+    segFunc.Assign(&items[0], segmentsCount);
+    double assignTime = Elapsed(start);
+
+    stringstream stream;
+    start = chrono::steady_clock::now();
+    segFunc.Save(stream);
+    double saveTime = Elapsed(start);
+    double megabytes = stream.str().size()/1e6;
+
+    start = chrono::steady_clock::now();
+    SegmentFunction<double> loaded = SegmentFunction<double>::Load(stream);
+    double loadTime = Elapsed(start);
+
+    if (loaded.GetSize() != segFunc.GetSize() || loaded(123456.5) != segFunc(123456.5)) throw runtime_error("Таблица загружена неверно!");
+    cout << "serialization: " << segmentsCount << " сегментов, " << megabytes << " МБ" << endl;
+    cout << "    запись " << saveTime << " мс (" << megabytes/saveTime*1000 << " МБ/с), загрузка " << loadTime
+         << " мс (" << megabytes/loadTime*1000 << " МБ/с), Assign готового массива " << assignTime << " мс" << endl;
+    cout << "    для сравнения " << definedCount << " Define: " << defineTime << " мс" << endl;
+}
+
+// Открытие замороженной таблицы из 10^6 сегментов через отображение против Load и вычисление по ней
+void bench_mapped(void) {
+    const int segmentsCount = 1000000, pointsCount = 1000000;
+    const char *path = "bench_mapped.sgfn";
+    DynamicArray<Segment<double>> items(segmentsCount);
+    for (int i = 0; i < segmentsCount; i++) {
+        Formula formula = i % 2 ? Formula::Quadratic(-1.0, 2.0*i, 0.25) : Formula::Linear(0.5, i);
+        items[i] = Segment<double>(i, i+1, [formula](double x) {return formula(x);}, formula);
+    }
+    SegmentFunction<double> segFunc;
+    segFunc.Assign(&items[0], segmentsCount);
+    {
+        ofstream out(path, ios::binary);
+        segFunc.Save(out, true);
+    }
+
+    auto start = chrono::steady_clock::now();
+    ifstream in(path, ios::binary);
+    SegmentFunction<double> loaded = SegmentFunction<double>::Load(in);
+    double loadTime = Elapsed(start);
+
+    start = chrono::steady_clock::now();
+    MappedSegmentFunction mapped(path);
+    double mapTime = Elapsed(start);
+
+    DynamicArray<double> xs(pointsCount), ys(pointsCount);
+    DynamicArray<EvaluationStatus> statuses(pointsCount);
+    for (int i = 0; i < pointsCount; i++) xs[i] = (i*7919LL % segmentsCount)+0.5;
+    start = chrono::steady_clock::now();
+    size_t loadedDefined = loaded.TryCalculateAt(&xs[0], pointsCount, &ys[0], &statuses[0]);
+    double loadedTime = Elapsed(start);
+    start = chrono::steady_clock::now();
+    size_t mappedDefined = mapped.TryCalculateAt(&xs[0], pointsCount, &ys[0], &statuses[0]);
+    double mappedTime = Elapsed(start);
+    remove(path);
+
+    if (loadedDefined != mappedDefined) throw runtime_error("Отображённая таблица вычисляется неверно!");
+    cout << "mapped: " << segmentsCount << " сегментов, открытие " << mapTime << " мс, Load " << loadTime << " мс" << endl;
+    cout << "    " << pointsCount << " случайных точек: загруженная " << loadedTime << " мс, отображённая " << mappedTime << " мс" << endl;
+}
+
+// Импорт CSV из 10^6 строк: только разбор и полная загрузка, последовательно и по потокам
+void bench_csv(void) {
+    const int segmentsCount = 1000000;
+    string text;
+    char line[160];
+    for (int i = 0; i < segmentsCount; i++) {
+        if (i % 2) snprintf(line, sizeof(line), "%d,%d,quadratic,%.17g,%.17g,0.25\n", i, i+1, -1.0/(i+1), 2.0*i);
+        else snprintf(line, sizeof(line), "%d,%d,linear,0.5,%.17g\n", i, i+1, i/3.0);
+        text += line;
+    }
+    double megabytes = text.size()/1e6;
+    cout << "csv: " << segmentsCount << " строк, " << megabytes << " МБ, потоков " << ParallelThreads(text.size(), 1 << 16) << endl;
+    for (bool parallel: {false, true}) {
+        stringstream input(text);
+        CsvReader reader(input, parallel);
+        DynamicArray<CsvRow> rows;
+        size_t count = 0;
+        auto start = chrono::steady_clock::now();
+        while (reader.Next(rows, count)) {}
+        double parseTime = Elapsed(start);
+
+        stringstream whole(text);
+        start = chrono::steady_clock::now();
+        SegmentFunction<double> segFunc = SegmentFunction<double>::Import(whole, parallel);
+        double importTime = Elapsed(start);
+
+        if (count != size_t(segmentsCount) || segFunc.GetSize() != count) throw runtime_error("CSV разобран неверно!");
+        cout << (parallel ? "    параллельно: " : "    последовательно: ") << "разбор " << parseTime << " мс (" << megabytes/parseTime*1000
+             << " МБ/с), импорт " << importTime << " мс (" << megabytes/importTime*1000 << " МБ/с)" << endl;
+    }
+}
+
+int run_benchmarks(void) {
+    bench_gaps();
+    bench_analysis();
+    bench_integrate();
+    bench_integral_index();
+    bench_solve();
+    bench_compile();
+    bench_compact();
+    bench_algebra();
+    bench_flatten();
+    bench_expression();
+    bench_serialization();
+    bench_mapped();
+    bench_csv();
+    return 0;
+}
+
+#endif // BENCHMARK_HPP
@@ -18,6 +18,7 @@ class ArraySequence: public Sequence<T> {
         ~ArraySequence() override;
         ArraySequence(T* items, size_t count);
         ArraySequence(const DynamicArray<T> &other);
+        ArraySequence(DynamicArray<T> &&other);
 
         // Декомпозиция
         size_t GetLength() const override;
@@ -70,6 +71,11 @@ ArraySequence<T>::ArraySequence(const DynamicArray<T> &other) {
     this->array = new DynamicArray<T>(other);
 }
 
+template <typename T>
+ArraySequence<T>::ArraySequence(DynamicArray<T> &&other) {
+    this->array = new DynamicArray<T>(std::move(other));
+}
+
 // Декомпозиция
 template <typename T>
 size_t ArraySequence<T>::GetLength() const {
@@ -117,6 +123,7 @@ Sequence<T>* ArraySequence<T>::Append(T item) {
     for (size_t i = 0; i < newSequence->array->GetSize(); i++) {
         newArray->Set(i, newSequence->array->Get(i));
     }
+    delete newSequence->array;
     newSequence->array = newArray;
     return newSequence;
 }
@@ -129,6 +136,7 @@ Sequence<T>* ArraySequence<T>::Prepend(T item) {
     for (size_t i = 0; i < newSequence->array->GetSize(); i++) {
         newArray->Set(i+1, newSequence->array->Get(i));
     }
+    delete newSequence->array;
     newSequence->array = newArray;
     return newSequence;
 }
@@ -147,6 +155,7 @@ Sequence<T>* ArraySequence<T>::Remove(size_t index) {
             newArray->Set(i-1, newSequence->array->Get(i));
         }
     }
+    delete newSequence->array;
     newSequence->array = newArray;
     return newSequence;
 }
@@ -173,6 +182,7 @@ Sequence<T>* ArraySequence<T>::PutAt(T item, size_t index) {
             newArray->Set(i+1, newSequence->array->Get(i));
         }
     }
+    delete newSequence->array;
     newSequence->array = newArray;
     return newSequence;
 }
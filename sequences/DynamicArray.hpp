@@ -1,6 +1,7 @@
 #ifndef DYNAMICARRAY_HPP
 #define DYNAMICARRAY_HPP
 
+#include <utility>
 
 template <typename T>
 class DynamicArray {
@@ -14,6 +15,7 @@ class DynamicArray {
         DynamicArray(size_t size);
         DynamicArray(T* items, size_t count);
         DynamicArray(const DynamicArray<T> &dynamicArray);
+        DynamicArray(DynamicArray<T> &&dynamicArray);
 
         // Декомпозиция
         size_t GetSize() const;
@@ -70,6 +72,14 @@ DynamicArray<T>::DynamicArray(const DynamicArray<T> &dynamicArray) {
     }
 }
 
+template <typename T>
+DynamicArray<T>::DynamicArray(DynamicArray<T> &&dynamicArray) {
+    this->size = dynamicArray.size;
+    this->data = dynamicArray.data;
+    dynamicArray.size = 0;
+    dynamicArray.data = nullptr;
+}
+
 // Декомпозиция
 template <typename T>
 size_t DynamicArray<T>::GetSize() const {
@@ -114,7 +124,7 @@ void DynamicArray<T>::Set(size_t index, T value) {
 template <typename T>
 void DynamicArray<T>::Resize(size_t newSize) {
     T* newData = new T[newSize];
-    for (size_t i = 0; i <= std::min(newSize, this->size); i++) {
+    for (size_t i = 0; i < std::min(newSize, this->size); i++) {
         newData[i] = this->data[i];
     }
     delete[] this->data;
@@ -1,8 +1,13 @@
 #ifndef TEST_HPP
 #define TEST_HPP
 
+#include <complex>
+#include <fstream>
 #include <iostream>
+#include <sstream>
+#include <thread>
 #include "../SegmentFunction.hpp"
+#include "../MappedSegmentFunction.hpp"
 #include "unity.h"
 
 
@@ -158,6 +163,854 @@ void mutable_immutable(void) {
     TEST_ASSERT_EQUAL_DOUBLE(36.75, segFuncIm(3.5));
 }
 
+void segment_index(void) {
+    SegmentFunction<double> grid;
+    for (int i = 0; i < 1000; i++) {
+        double k = i;
+        grid.Define(i*0.01, (i+1)*0.01, [k](double x) {return k;});
+    }
+    TEST_ASSERT_TRUE(grid.IsUniform());
+    TEST_ASSERT_EQUAL(0, grid.FindSegment(0.0));
+    TEST_ASSERT_EQUAL(0, grid.FindSegment(0.01));
+    TEST_ASSERT_EQUAL(123, grid.FindSegment(1.235));
+    TEST_ASSERT_EQUAL(999, grid.FindSegment(10.0));
+    TEST_ASSERT_EQUAL(1000, grid.FindSegment(10.5));
+    TEST_ASSERT_EQUAL_DOUBLE(500, grid(5.005));
+
+    SegmentFunction<double> segFunc;
+    segFunc.Define(3.0, 4.0, [](double x) {return 1;});
+    segFunc.Define(-2.0, -1.0, [](double x) {return 2;});
+    segFunc.Define(0.0, 0.1, [](double x) {return 3;});
+    segFunc.Define(10.0, 100.0, [](double x) {return 4;});
+    TEST_ASSERT_FALSE(segFunc.IsUniform());
+    TEST_ASSERT_EQUAL_DOUBLE(-2.0, segFunc.Get(0).start);
+    TEST_ASSERT_EQUAL_DOUBLE(10.0, segFunc.Get(3).start);
+    TEST_ASSERT_EQUAL_DOUBLE(2, segFunc(-1.5));
+    TEST_ASSERT_EQUAL_DOUBLE(3, segFunc(0.1));
+    TEST_ASSERT_EQUAL_DOUBLE(1, segFunc(3.5));
+    TEST_ASSERT_EQUAL_DOUBLE(4, segFunc(50.0));
+    TEST_ASSERT_EQUAL(4, segFunc.FindSegment(5.0));
+    TEST_ASSERT_EQUAL(4, segFunc.FindSegment(-3.0));
+}
+
+void lookup_cursor(void) {
+    SegmentFunction<double> segFunc;
+    for (int i = 0; i < 100; i++) segFunc.Define(i, i+1, [](double x) {return 2*x;});
+    segFunc.ResetLookupStatistics();
+    for (double x = 0.25; x < 100; x += 0.5) TEST_ASSERT_EQUAL_DOUBLE(2*x, segFunc(x));
+    HitStatistics statistics = segFunc.GetLookupStatistics();
+    TEST_ASSERT_EQUAL(200, statistics.Total());
+    TEST_ASSERT_EQUAL(200, statistics.hits);
+
+    segFunc.ResetLookupStatistics();
+    TEST_ASSERT_EQUAL(10, segFunc.FindSegment(10.5));
+    TEST_ASSERT_EQUAL(9, segFunc.FindSegment(10.0));
+    TEST_ASSERT_EQUAL(70, segFunc.FindSegment(70.5));
+    TEST_ASSERT_EQUAL(1, segFunc.GetLookupStatistics().hits);
+    TEST_ASSERT_EQUAL(2, segFunc.GetLookupStatistics().misses);
+
+    segFunc.Define(50.5, 60.5, [](double x) {return 2*x;});
+    const SegmentFunction<double> &shared = segFunc;
+    bool correct[4];
+    std::thread readers[4];
+    for (int t = 0; t < 4; t++) {
+        readers[t] = std::thread([&shared, &correct, t]() {
+            bool ok = true;
+            for (int i = 0; i < 2000; i++) {
+                double x = (i*37+t*11) % 1000/10.0+0.05;
+                size_t k = shared.FindSegment(x);
+                ok = ok && k < shared.GetSize() && shared.Get(k).start <= x && x <= shared.Get(k).end;
+                if (i % 100 == 0) ok = ok && shared.IsMonotonic() && shared.RangeMin(x, x+1) == 2*x;
+            }
+            correct[t] = ok;
+        });
+    }
+    for (int t = 0; t < 4; t++) readers[t].join();
+    for (int t = 0; t < 4; t++) TEST_ASSERT_TRUE(correct[t]);
+}
+
+void evaluation_cache(void) {
+    int calls = 0;
+    SegmentFunction<double> segFunc;
+    segFunc.Define(0.0, 10.0, [&calls](double x) {calls++; return x*x;});
+    segFunc.EnableCache(2);
+    calls = 0;
+    TEST_ASSERT_EQUAL_DOUBLE(4, segFunc(2.0));
+    TEST_ASSERT_EQUAL_DOUBLE(4, segFunc(2.0));
+    TEST_ASSERT_EQUAL_DOUBLE(9, segFunc(3.0));
+    TEST_ASSERT_EQUAL_DOUBLE(4, segFunc(2.0));
+    TEST_ASSERT_EQUAL(2, calls);
+    TEST_ASSERT_EQUAL(2, segFunc.GetCacheStatistics().hits);
+    TEST_ASSERT_EQUAL(2, segFunc.GetCacheStatistics().misses);
+
+    segFunc(5.0);
+    segFunc(2.0);
+    TEST_ASSERT_EQUAL(3, calls);
+
+    segFunc.Define(1.0, 4.0, [](double x) {return -x;});
+    calls = 0;
+    TEST_ASSERT_EQUAL_DOUBLE(-2, segFunc(2.0));
+    TEST_ASSERT_EQUAL_DOUBLE(25, segFunc(5.0));
+    TEST_ASSERT_EQUAL(0, calls);
+
+    segFunc.Clear();
+    try {
+        segFunc(5.0);
+        TEST_FAIL();
+    } catch (const out_of_range&) {}
+    segFunc.DisableCache();
+    TEST_ASSERT_EQUAL(0, segFunc.GetCacheStatistics().Total());
+}
+
+void segment_ids(void) {
+    SegmentFunction<double> segFunc;
+    segFunc.Define(0.0, 1.0, [](double x) {return x;});
+    segFunc.Define(1.0, 2.0, [](double x) {return x*x;});
+    segFunc.Define(2.0, 3.0, [](double x) {return 4;});
+    size_t first = segFunc.Get(0).id, second = segFunc.Get(1).id, third = segFunc.Get(2).id;
+    TEST_ASSERT_TRUE(first != second && second != third);
+
+    segFunc.Define(0.5, 1.5, [](double x) {return 3*x;});
+    TEST_ASSERT_EQUAL(first, segFunc.Get(0).id);
+    TEST_ASSERT_EQUAL(second, segFunc.Get(2).id);
+    TEST_ASSERT_EQUAL(third, segFunc.Get(3).id);
+
+    segFunc.Define(2.2, 2.8, [](double x) {return 5;});
+    TEST_ASSERT_EQUAL(6, segFunc.GetSize());
+    TEST_ASSERT_EQUAL_DOUBLE(2.8, segFunc.Get(5).start);
+    TEST_ASSERT_EQUAL(third, segFunc.Get(5).id);
+    TEST_ASSERT_TRUE(segFunc.Get(3).id != third);
+
+    SegmentFunction<double> copy(segFunc);
+    TEST_ASSERT_EQUAL(segFunc.Get(1).id, copy.Get(1).id);
+}
+
+void try_calculate(void) {
+    SegmentFunction<double> segFunc;
+    segFunc.Define(0.0, 1.0, [](double x) {return x;});
+    segFunc.Define(1.0, 2.0, [](double x) {return x+1;});
+    segFunc.Define(3.0, 4.0, [](double x) {return 5;});
+
+    double value = 0;
+    TEST_ASSERT_TRUE(segFunc.TryCalculateAt(0.5, value) == EvaluationStatus::Defined);
+    TEST_ASSERT_EQUAL_DOUBLE(0.5, value);
+    TEST_ASSERT_TRUE(segFunc.TryCalculateAt(1.0, value) == EvaluationStatus::Discontinuity);
+    TEST_ASSERT_TRUE(segFunc.TryCalculateAt(2.5, value) == EvaluationStatus::Undefined);
+
+    double xs[5] = {-1.0, 0.25, 1.0, 1.5, 3.5};
+    double ys[5];
+    EvaluationStatus statuses[5];
+    TEST_ASSERT_EQUAL(3, segFunc.TryCalculateAt(xs, 5, ys, statuses));
+    TEST_ASSERT_TRUE(statuses[0] == EvaluationStatus::Undefined);
+    TEST_ASSERT_TRUE(statuses[2] == EvaluationStatus::Discontinuity);
+    TEST_ASSERT_EQUAL_DOUBLE(0.25, ys[1]);
+    TEST_ASSERT_EQUAL_DOUBLE(2.5, ys[3]);
+    TEST_ASSERT_EQUAL_DOUBLE(5, ys[4]);
+}
+
+void junction_index(void) {
+    int calls = 0;
+    SegmentFunction<double> segFunc;
+    segFunc.Define(0.0, 1.0, [&calls](double x) {calls++; return x;});
+    segFunc.Define(1.0, 2.0, [&calls](double x) {calls++; return 2-x;});
+    segFunc.Define(2.0, 3.0, [&calls](double x) {calls++; return x;});
+    TEST_ASSERT_TRUE(segFunc.Get(0).junction == Junction::Continuous);
+    TEST_ASSERT_TRUE(segFunc.Get(1).junction == Junction::Jump);
+    TEST_ASSERT_TRUE(segFunc.Get(2).junction == Junction::None);
+    TEST_ASSERT_FALSE(segFunc.IsContinuous());
+
+    calls = 0;
+    double value;
+    TEST_ASSERT_TRUE(segFunc.TryCalculateAt(1.0, value) == EvaluationStatus::Defined);
+    TEST_ASSERT_EQUAL_DOUBLE(1, value);
+    TEST_ASSERT_TRUE(segFunc.TryCalculateAt(2.0, value) == EvaluationStatus::Discontinuity);
+    TEST_ASSERT_EQUAL(0, calls);
+
+    segFunc.Define(1.5, 2.5, [](double x) {return 0.5;});
+    TEST_ASSERT_TRUE(segFunc.Get(1).junction == Junction::Continuous);
+    TEST_ASSERT_TRUE(segFunc.Get(2).junction == Junction::Jump);
+    segFunc.Define(1.5, 2.5, [](double x) {return 2*x-2.5;});
+    TEST_ASSERT_TRUE(segFunc.Get(1).junction == Junction::Continuous);
+    TEST_ASSERT_TRUE(segFunc.Get(2).junction == Junction::Continuous);
+    TEST_ASSERT_TRUE(segFunc.IsContinuous());
+
+    segFunc.Define(4.0, 5.0, [](double x) {return 3;});
+    TEST_ASSERT_TRUE(segFunc.Get(2).junction == Junction::Continuous);
+    TEST_ASSERT_TRUE(segFunc.Get(3).junction == Junction::Gap);
+    TEST_ASSERT_FALSE(segFunc.IsContinuous());
+    segFunc.Define(2.9, 4.5, [](double x) {return 3;});
+    TEST_ASSERT_TRUE(segFunc.Get(3).junction == Junction::Jump);
+    TEST_ASSERT_FALSE(segFunc.IsContinuous());
+    segFunc.Define(2.9, 4.5, [](double x) {return x;});
+    TEST_ASSERT_FALSE(segFunc.IsContinuous());
+    segFunc.Define(2.9, 5.0, [](double x) {return x;});
+    TEST_ASSERT_EQUAL(5, segFunc.GetSize());
+    TEST_ASSERT_TRUE(segFunc.IsContinuous());
+
+    SegmentFunction<complex<double>> complexFunc;
+    complexFunc.Define(0.0, 1.0, [](double x) {return complex<double>(x, -x);});
+    complexFunc.Define(1.0, 2.0, [](double x) {return complex<double>(x, 1);});
+    complex<double> complexValue;
+    TEST_ASSERT_TRUE(complexFunc.TryCalculateAt(1.0, complexValue) == EvaluationStatus::Discontinuity);
+    TEST_ASSERT_TRUE(complexFunc.TryCalculateAt(1.5, complexValue) == EvaluationStatus::Defined);
+    TEST_ASSERT_EQUAL_DOUBLE(1, complexValue.imag());
+    TEST_ASSERT_FALSE(complexFunc.IsContinuous());
+    complexFunc.Define(0.0, 1.0, [](double x) {return complex<double>(x, 1);});
+    TEST_ASSERT_TRUE(complexFunc.IsContinuous());
+}
+
+void incremental_monotony(void) {
+    int calls = 0;
+    SegmentFunction<double> segFunc;
+    for (int i = 0; i < 10; i++) segFunc.Define(i, i+1, [&calls](double x) {calls++; return x;});
+    TEST_ASSERT_TRUE(segFunc.IsMonotonic());
+    TEST_ASSERT_TRUE(segFunc.Get(3).monotony == Monotony::Increasing);
+
+    calls = 0;
+    TEST_ASSERT_TRUE(segFunc.IsMonotonic());
+    TEST_ASSERT_TRUE(segFunc.IsContinuous());
+    TEST_ASSERT_EQUAL(0, calls);
+
+    segFunc.Define(4.0, 5.0, [](double x) {return 4;});
+    TEST_ASSERT_TRUE(segFunc.Get(4).monotony == Monotony::Unknown);
+    TEST_ASSERT_TRUE(segFunc.Get(3).monotony == Monotony::Increasing);
+    calls = 0;
+    TEST_ASSERT_TRUE(segFunc.IsMonotonic());
+    TEST_ASSERT_TRUE(segFunc.Get(4).monotony == Monotony::Constant);
+    TEST_ASSERT_FALSE(segFunc.IsContinuous());
+
+    segFunc.Define(4.0, 5.0, [](double x) {return 8-x;});
+    TEST_ASSERT_FALSE(segFunc.IsMonotonic());
+    segFunc.Define(4.0, 5.0, [](double x) {return 4+(x-4)*(x-4);});
+    TEST_ASSERT_TRUE(segFunc.IsMonotonic());
+    segFunc.Define(4.0, 5.0, [](double x) {return 4+sin(10*x);});
+    TEST_ASSERT_FALSE(segFunc.IsMonotonic());
+    TEST_ASSERT_TRUE(segFunc.Get(4).monotony == Monotony::None);
+    segFunc.Define(4.0, 5.0, [](double x) {return x;});
+    TEST_ASSERT_TRUE(segFunc.IsMonotonic());
+    TEST_ASSERT_TRUE(segFunc.IsContinuous());
+
+    segFunc.Define(12.0, 13.0, [](double x) {return x;});
+    TEST_ASSERT_FALSE(segFunc.IsMonotonic());
+    segFunc.Clear();
+    TEST_ASSERT_FALSE(segFunc.IsMonotonic());
+}
+
+void analytic_monotony(void) {
+    TEST_ASSERT_TRUE(Formula::Quadratic(1, -2, 0).MonotonyOn(1, 3) == Monotony::Increasing);
+    TEST_ASSERT_TRUE(Formula::Quadratic(1, -2, 0).MonotonyOn(0, 2) == Monotony::None);
+    TEST_ASSERT_TRUE(Formula::Hyperbolic(1, 0, 0).MonotonyOn(-1, 1) == Monotony::None);
+    TEST_ASSERT_TRUE(Formula::Hyperbolic(1, 0, 0).MonotonyOn(1, 2) == Monotony::Decreasing);
+    TEST_ASSERT_TRUE(Formula::Power(2).MonotonyOn(-2, -1) == Monotony::Decreasing);
+    TEST_ASSERT_TRUE(Formula::Power(3).MonotonyOn(-2, 2) == Monotony::Increasing);
+    TEST_ASSERT_TRUE(Formula::Power(0.5).MonotonyOn(-2, 2) == Monotony::None);
+    TEST_ASSERT_TRUE(Formula::Sine(1, 1, 0, 0).MonotonyOn(-1.5, 1.5) == Monotony::Increasing);
+    TEST_ASSERT_TRUE(Formula::Sine(-2, -1, 0, 0).MonotonyOn(0, 1) == Monotony::Increasing);
+
+    // Частые колебания между точками выборки: по выборке монотонна, аналитически - нет
+    SegmentFunction<double> segFunc;
+    auto sine = Formula::Sine(1, 200*acos(-1.0), acos(-1.0)/2, 0);
+    segFunc.Define(0.0, 1.0, [sine](double x) {return sine(x);});
+    TEST_ASSERT_TRUE(segFunc.IsMonotonic());
+    segFunc.Define(0.0, 1.0, sine);
+    TEST_ASSERT_FALSE(segFunc.IsMonotonic());
+    TEST_ASSERT_EQUAL_DOUBLE(1, segFunc(0.0));
+
+    segFunc.Define(0.0, 1.0, [](double x) {return 1+sin(300*acos(-1.0)*x);});
+    segFunc.Define(1.0, 2.0, Formula::Linear(1, 0));
+    TEST_ASSERT_TRUE(segFunc.IsMonotonic());
+    segFunc.SetMonotonicSamples(1000);
+    TEST_ASSERT_FALSE(segFunc.IsMonotonic());
+    TEST_ASSERT_TRUE(segFunc.Get(1).monotony == Monotony::Increasing);
+}
+
+void analyze_all(void) {
+    SegmentFunction<double> segFunc;
+    for (int i = 0; i < 1000; i++) segFunc.Define(i, i+1, [](double x) {return x;});
+    segFunc.Define(500.0, 501.0, [](double x) {return 500+(x-500)*(501-x);});
+    FunctionAnalysis<double> analysis = segFunc.AnalyzeAll();
+    TEST_ASSERT_EQUAL_DOUBLE(0, analysis.min);
+    TEST_ASSERT_EQUAL_DOUBLE(1000, analysis.max);
+    TEST_ASSERT_FALSE(analysis.monotonic);
+    TEST_ASSERT_FALSE(analysis.continuous);
+    TEST_ASSERT_DOUBLE_WITHIN(1e-9, 500.25, segFunc.Get(500).maxValue);
+
+    segFunc.Define(500.0, 501.0, Formula::Quadratic(-1, 1001, -250000));
+    segFunc.Define(2000.0, 2001.0, Formula::Constant(-5));
+    analysis = segFunc.AnalyzeAll();
+    TEST_ASSERT_EQUAL_DOUBLE(-5, analysis.min);
+    TEST_ASSERT_FALSE(analysis.monotonic);
+    segFunc.Define(500.0, 501.0, Formula::Linear(1, 0));
+    segFunc.Define(1000.0, 2000.0, Formula::Linear(0, 1000));
+    segFunc.Define(2000.0, 2001.0, Formula::Linear(1, -1000));
+    analysis = segFunc.AnalyzeAll();
+    TEST_ASSERT_TRUE(analysis.monotonic);
+    TEST_ASSERT_TRUE(analysis.continuous);
+    TEST_ASSERT_EQUAL_DOUBLE(1001, analysis.max);
+
+    SegmentFunction<double> empty;
+    TEST_ASSERT_FALSE(empty.IsMonotonic());
+    TEST_ASSERT_FALSE(empty.IsContinuous());
+}
+
+void integrate(void) {
+    SegmentFunction<double> segFunc;
+    segFunc.Define(0.0, 2.0, Formula::Linear(1, 0));
+    segFunc.Define(2.0, 3.0, Formula::Quadratic(1, 0, 0));
+    segFunc.Define(3.0, 3.0+acos(-1.0), [](double x) {return sin(x-3);});
+    IntegrationResult result = segFunc.Integrate(1.0, 2.5);
+    TEST_ASSERT_DOUBLE_WITHIN(1e-12, 1.5+(2.5*2.5*2.5-8)/3, result.value);
+    result = segFunc.Integrate(0.0, 3.0+acos(-1.0));
+    TEST_ASSERT_DOUBLE_WITHIN(1e-9, 2+19.0/3+2, result.value);
+    TEST_ASSERT_TRUE(result.error < 1e-9);
+    TEST_ASSERT_EQUAL_DOUBLE(0, segFunc.Integrate(2.0, 2.0).value);
+
+    segFunc.Define(10.0, 11.0, Formula::Hyperbolic(1, 0, 0));
+    TEST_ASSERT_DOUBLE_WITHIN(1e-12, log(1.1), segFunc.Integrate(10.0, 11.0).value);
+    try {
+        segFunc.Integrate(2.0, 10.5);
+        TEST_FAIL();
+    } catch (const out_of_range&) {}
+    try {
+        segFunc.Integrate(-1.0, 1.0);
+        TEST_FAIL();
+    } catch (const out_of_range&) {}
+    try {
+        segFunc.Integrate(2.0, 1.0);
+        TEST_FAIL();
+    } catch (const invalid_argument&) {}
+
+    segFunc.Clear();
+    for (int i = 0; i < 1000; i++) segFunc.Define(i, i+1, [](double x) {return exp(-x/100);});
+    result = segFunc.Integrate(0.0, 1000.0);
+    TEST_ASSERT_DOUBLE_WITHIN(1e-9, 100*(1-exp(-10.0)), result.value);
+}
+
+void integral_index(void) {
+    int calls = 0;
+    SegmentFunction<double> segFunc;
+    for (int i = 0; i < 100; i++) segFunc.Define(i, i+1, Formula::Linear(1, 0));
+    segFunc.Define(50.0, 51.0, [&calls](double x) {calls++; return x;});
+    segFunc.EnableIntegralIndex();
+    TEST_ASSERT_DOUBLE_WITHIN(1e-9, 5000, segFunc.Integrate(0.0, 100.0).value);
+    TEST_ASSERT_DOUBLE_WITHIN(1e-9, (80.25*80.25-10.5*10.5)/2, segFunc.Integrate(10.5, 80.25).value);
+    TEST_ASSERT_DOUBLE_WITHIN(1e-9, (3.75*3.75-3.25*3.25)/2, segFunc.Integrate(3.25, 3.75).value);
+
+    calls = 0;
+    for (int i = 0; i < 50; i++) segFunc.Integrate(i, 100-i);
+    TEST_ASSERT_EQUAL(0, calls);
+
+    segFunc.Define(20.0, 30.0, Formula::Constant(0));
+    TEST_ASSERT_DOUBLE_WITHIN(1e-9, 5000-(900-400)/2.0, segFunc.Integrate(0.0, 100.0).value);
+    TEST_ASSERT_EQUAL(0, calls);
+    segFunc.Define(120.0, 130.0, Formula::Constant(1));
+    TEST_ASSERT_DOUBLE_WITHIN(1e-9, 10, segFunc.Integrate(120.0, 130.0).value);
+    try {
+        segFunc.Integrate(99.0, 121.0);
+        TEST_FAIL();
+    } catch (const out_of_range&) {}
+
+    SegmentFunction<double> copy(segFunc);
+    TEST_ASSERT_DOUBLE_WITHIN(1e-9, 4750, copy.Integrate(0.0, 100.0).value);
+    segFunc.DisableIntegralIndex();
+    TEST_ASSERT_DOUBLE_WITHIN(1e-9, 5000-(900-400)/2.0, segFunc.Integrate(0.0, 100.0).value);
+}
+
+void solve(void) {
+    SegmentFunction<double> segFunc;
+    segFunc.Define(0.0, 1.0, Formula::Linear(2, 0));
+    segFunc.Define(1.0, 2.0, Formula::Quadratic(1, 0, 1));
+    segFunc.Define(2.0, 3.0, [](double x) {return exp(x)-exp(2)+5;});
+    segFunc.Define(3.0, 4.0, Formula::Constant(25));
+    TEST_ASSERT_DOUBLE_WITHIN(1e-12, 0.25, segFunc.Solve(0.5));
+    TEST_ASSERT_DOUBLE_WITHIN(1e-12, sqrt(3.0), segFunc.Solve(4));
+    TEST_ASSERT_DOUBLE_WITHIN(1e-10, log(7+exp(2)-5), segFunc.Solve(7));
+    TEST_ASSERT_EQUAL_DOUBLE(3, segFunc.Solve(exp(3)-exp(2)+5));
+    TEST_ASSERT_EQUAL_DOUBLE(3, segFunc.Solve(25));
+    double x;
+    TEST_ASSERT_TRUE(segFunc.TrySolve(20, x) == EvaluationStatus::Discontinuity);
+    TEST_ASSERT_TRUE(segFunc.TrySolve(-1, x) == EvaluationStatus::Undefined);
+    TEST_ASSERT_TRUE(segFunc.TrySolve(26, x) == EvaluationStatus::Undefined);
+    try {
+        segFunc.Solve(20);
+        TEST_FAIL();
+    } catch (const domain_error&) {}
+
+    double ys[4] = {0.5, 4, 20, 100}, xs[4];
+    EvaluationStatus statuses[4];
+    TEST_ASSERT_EQUAL(2, segFunc.TrySolve(ys, 4, xs, statuses));
+    TEST_ASSERT_DOUBLE_WITHIN(1e-12, sqrt(3.0), xs[1]);
+    TEST_ASSERT_TRUE(statuses[3] == EvaluationStatus::Undefined);
+
+    SegmentFunction<double> wave;
+    wave.Define(0.0, 4*acos(-1.0), Formula::Sine(1, 1, 0, 0));
+    wave.Define(4*acos(-1.0), 20.0, [](double x) {return cos(x);});
+    Sequence<double> *roots = wave.SolveAll(0.5);
+    TEST_ASSERT_EQUAL(7, roots->GetLength());
+    TEST_ASSERT_DOUBLE_WITHIN(1e-12, asin(0.5), roots->Get(0));
+    TEST_ASSERT_DOUBLE_WITHIN(1e-12, acos(-1.0)-asin(0.5), roots->Get(1));
+    TEST_ASSERT_DOUBLE_WITHIN(1e-10, 4*acos(-1.0)+acos(0.5), roots->Get(4));
+    TEST_ASSERT_DOUBLE_WITHIN(1e-12, asin(0.5), wave.Solve(0.5));
+    delete roots;
+}
+
+void range_extrema(void) {
+    SegmentFunction<double> segFunc;
+    for (int i = 0; i < 100; i++) segFunc.Define(i, i+1, Formula::Constant(i%7));
+    segFunc.Define(10.0, 11.0, Formula::Quadratic(-1, 21, -100));
+    segFunc.Define(50.0, 52.0, [](double x) {return -5+(x-51)*(x-51);});
+    TEST_ASSERT_EQUAL_DOUBLE(-5, segFunc.RangeMin(0.0, 100.0));
+    TEST_ASSERT_DOUBLE_WITHIN(1e-12, 10.25, segFunc.RangeMax(0.0, 100.0));
+    TEST_ASSERT_DOUBLE_WITHIN(1e-12, 10.25, segFunc.RangeMax(10.25, 10.75));
+    TEST_ASSERT_DOUBLE_WITHIN(1e-12, 10.1875, segFunc.RangeMax(10.0, 10.25));
+    TEST_ASSERT_EQUAL_DOUBLE(-5, segFunc.RangeMin(20.0, 80.0));
+    TEST_ASSERT_EQUAL_DOUBLE(-4.75, segFunc.RangeMin(51.5, 52.0));
+    TEST_ASSERT_EQUAL_DOUBLE(2, segFunc.RangeMin(2.5, 6.5));
+    TEST_ASSERT_EQUAL_DOUBLE(6, segFunc.RangeMax(2.5, 6.5));
+
+    segFunc.Define(30.0, 33.0, Formula::Sine(3, 1, 0, 0));
+    TEST_ASSERT_EQUAL_DOUBLE(3, segFunc.RangeMax(30.0, 33.0));
+    segFunc.Define(200.0, 201.0, Formula::Constant(-10));
+    TEST_ASSERT_EQUAL_DOUBLE(-10, segFunc.RangeMin(90.0, 300.0));
+    try {
+        segFunc.RangeMin(150.0, 160.0);
+        TEST_FAIL();
+    } catch (const out_of_range&) {}
+
+    SegmentFunction<double> poles;
+    poles.Define(-1.0, 1.0, Formula::Power(-2));
+    poles.Define(1.0, 2.0, Formula::Hyperbolic(1, -1, 0));
+    poles.Define(2.0, 4.0, Formula::Hyperbolic(-2, -3, 1));
+    TEST_ASSERT_EQUAL_DOUBLE(1, poles.RangeMin(-1.0, 1.0));
+    TEST_ASSERT_TRUE(poles.RangeMax(-1.0, 1.0) == INFINITY);
+    TEST_ASSERT_EQUAL_DOUBLE(1, poles.RangeMin(1.0, 2.0));
+    TEST_ASSERT_TRUE(poles.RangeMax(1.0, 2.0) == INFINITY);
+    TEST_ASSERT_EQUAL_DOUBLE(2, poles.RangeMax(1.5, 2.0));
+    TEST_ASSERT_TRUE(poles.RangeMin(2.0, 4.0) == -INFINITY && poles.RangeMax(2.0, 4.0) == INFINITY);
+    TEST_ASSERT_EQUAL_DOUBLE(-3, poles.RangeMin(3.5, 4.0));
+    TEST_ASSERT_EQUAL_DOUBLE(5, poles.RangeMax(2.0, 2.5));
+    SegmentFunction<double> odd;
+    odd.Define(-1.0, 0.0, Formula::Power(-3));
+    TEST_ASSERT_EQUAL_DOUBLE(-1, odd.RangeMax(-1.0, 0.0));
+    TEST_ASSERT_TRUE(odd.RangeMin(-1.0, 0.0) == -INFINITY);
+}
+
+void compile_chebyshev(void) {
+    SegmentFunction<double> segFunc;
+    segFunc.Define(0.0, 1.0, [](double x) {return exp(x);});
+    segFunc.Define(1.0, 5.0, [](double x) {return sin(10*x);});
+    segFunc.Define(5.0, 6.0, Formula::Linear(2, 1));
+    segFunc.Define(7.0, 8.0, [](double x) {return 1/(x-7.5);});
+    CompilationReport report;
+    SegmentFunction<double> compiled = segFunc.Compile(1e-10, &report);
+    TEST_ASSERT_EQUAL(4, compiled.GetSize());
+    TEST_ASSERT_EQUAL(2, report.segments);
+    TEST_ASSERT_EQUAL(1, report.skipped);
+    TEST_ASSERT_TRUE(report.pieces > 2);
+    TEST_ASSERT_TRUE(report.bytes >= report.pieces*9*sizeof(double));
+    TEST_ASSERT_TRUE(report.maxError <= 1e-10);
+    for (int i = 0; i <= 600; i++) {
+        double x = i/100.0+0.001, expected, actual;
+        TEST_ASSERT_TRUE(segFunc.TryCalculateAt(x, expected) == compiled.TryCalculateAt(x, actual));
+        if (i < 600) TEST_ASSERT_DOUBLE_WITHIN(1e-10, expected, actual);
+    }
+    TEST_ASSERT_TRUE(compiled.Get(2).formula.kind == FormulaKind::Linear);
+    TEST_ASSERT_EQUAL_DOUBLE(segFunc(7.25), compiled(7.25));
+    TEST_ASSERT_TRUE(compiled.IsContinuous() == segFunc.IsContinuous());
+
+    double error;
+    auto wild = [](double x) {return sin(1/x);};
+    TEST_ASSERT_NULL(ChebyshevTable::Compile(wild, 1e-4, 0.1, 1e-6, error, 8, 64).get());
+    TEST_ASSERT_TRUE(error > 1e-6);
+    SegmentFunction<double> oscillating;
+    oscillating.Define(1e-4, 0.1, wild);
+    oscillating.Define(0.1, 1.0, [](double x) {return x;});
+    compiled = oscillating.Compile(1e-6, &report);
+    TEST_ASSERT_EQUAL(1, report.segments);
+    TEST_ASSERT_EQUAL(1, report.skipped);
+    TEST_ASSERT_EQUAL_DOUBLE(sin(1/0.00123), compiled(0.00123));
+    TEST_ASSERT_TRUE(compiled.Get(0).func.target_type() == oscillating.Get(0).func.target_type());
+}
+
+void compact_segments(void) {
+    double (*square)(double) = [](double x) {return x*x;};
+    SegmentFunction<double> segFunc;
+    segFunc.Define(0.0, 1.0, Formula::Linear(1, 0));
+    segFunc.Define(1.0, 2.0, Formula::Linear(1, 0));
+    segFunc.Define(2.0, 3.0, Formula::Linear(1, 0));
+    segFunc.Define(3.0, 4.0, Formula::Constant(2));
+    segFunc.Define(3.0+1e-13, 5.0, Formula::Constant(3));
+    segFunc.Define(5.0, 6.0, square);
+    segFunc.Define(6.0, 7.0, square);
+    segFunc.Define(8.0, 9.0, [](double x) {return x;});
+    segFunc.Define(9.0, 10.0, [](double x) {return x;});
+    TEST_ASSERT_EQUAL(9, segFunc.GetSize());
+
+    CompactionStatistics statistics = segFunc.Compact();
+    TEST_ASSERT_EQUAL(3, statistics.merged);
+    TEST_ASSERT_EQUAL(1, statistics.slivers);
+    TEST_ASSERT_EQUAL(5, segFunc.GetSize());
+    TEST_ASSERT_EQUAL_DOUBLE(0.0, segFunc.Get(0).start);
+    TEST_ASSERT_EQUAL_DOUBLE(3.0+1e-13, segFunc.Get(0).end);
+    TEST_ASSERT_EQUAL_DOUBLE(7.0, segFunc.Get(2).end);
+    TEST_ASSERT_EQUAL_DOUBLE(2.5, segFunc(2.5));
+    TEST_ASSERT_EQUAL_DOUBLE(3.0, segFunc(4.0));
+    TEST_ASSERT_EQUAL_DOUBLE(30.25, segFunc(5.5));
+    TEST_ASSERT_EQUAL_DOUBLE(4.5, segFunc.Integrate(0.0, 3.0).value);
+    TEST_ASSERT_EQUAL_DOUBLE(0.0, segFunc.RangeMin(0.0, 7.0));
+    TEST_ASSERT_EQUAL_DOUBLE(49.0, segFunc.RangeMax(0.0, 7.0));
+    TEST_ASSERT_EQUAL(0, segFunc.Compact().Total());
+    TEST_ASSERT_EQUAL(4, segFunc.GetCompactionStatistics().Total());
+
+    SegmentFunction<double> automatic;
+    automatic.EnableAutoCompact();
+    for (int i = 0; i < 100; i++) automatic.Define(i, i+1, Formula::Constant(1));
+    TEST_ASSERT_EQUAL(1, automatic.GetSize());
+    TEST_ASSERT_EQUAL(99, automatic.GetCompactionStatistics().merged);
+    automatic.Define(10.0, 20.0, Formula::Constant(2));
+    TEST_ASSERT_EQUAL(3, automatic.GetSize());
+    automatic.Define(10.0, 20.0, Formula::Constant(1));
+    TEST_ASSERT_EQUAL(1, automatic.GetSize());
+    TEST_ASSERT_TRUE(automatic.IsMonotonic());
+    TEST_ASSERT_TRUE(automatic.IsContinuous());
+    TEST_ASSERT_EQUAL_DOUBLE(100.0, automatic.Integrate(0.0, 100.0).value);
+}
+
+void function_algebra(void) {
+    SegmentFunction<double> f, g, h;
+    f.Define(0.0, 2.0, Formula::Linear(1, 0));
+    f.Define(2.0, 4.0, Formula::Constant(2));
+    g.Define(1.0, 3.0, Formula::Quadratic(1, 0, 0));
+    g.Define(3.0, 5.0, [](double x) {return -x;});
+    h.Define(0.0, 4.0, Formula::Linear(2, 1));
+
+    SegmentFunction<double> sum = f+g;
+    TEST_ASSERT_EQUAL(3, sum.GetSize());
+    TEST_ASSERT_EQUAL_DOUBLE(1.0, sum.Get(0).start);
+    TEST_ASSERT_EQUAL_DOUBLE(4.0, sum.Get(2).end);
+    TEST_ASSERT_TRUE(sum.Get(0).formula == Formula::Quadratic(1, 1, 0));
+    TEST_ASSERT_TRUE(sum.Get(1).formula == Formula::Quadratic(1, 0, 2));
+    TEST_ASSERT_TRUE(sum.Get(2).formula.IsOpaque());
+    TEST_ASSERT_EQUAL_DOUBLE(3.75, sum(1.5));
+    TEST_ASSERT_EQUAL_DOUBLE(-1.5, sum(3.5));
+    TEST_ASSERT_TRUE(sum.Integrate(1.0, 2.0).error < 1e-12);
+
+    TEST_ASSERT_TRUE((f-f).Get(0).formula == Formula::Constant(0));
+    SegmentFunction<double> product = f*g;
+    TEST_ASSERT_TRUE(product.Get(0).formula.IsOpaque());
+    TEST_ASSERT_EQUAL_DOUBLE(3.375, product(1.5));
+    TEST_ASSERT_TRUE(product.Get(1).formula == Formula::Quadratic(2, 0, 0));
+    SegmentFunction<double> quotient = f/h;
+    TEST_ASSERT_TRUE(quotient.Get(1).formula.kind == FormulaKind::Hyperbolic);
+    TEST_ASSERT_DOUBLE_WITHIN(1e-12, 2.0/7, quotient(3.0));
+    TEST_ASSERT_DOUBLE_WITHIN(1e-12, -2.0/3.5, (f/g)(3.5));
+
+    SegmentFunction<double> low = Min(f, g), high = Max(f, g);
+    TEST_ASSERT_EQUAL_DOUBLE(1.5, low(1.5));
+    TEST_ASSERT_EQUAL_DOUBLE(2.25, high(1.5));
+    TEST_ASSERT_TRUE(low.Get(1).formula == Formula::Constant(2));
+    TEST_ASSERT_TRUE(high.Get(1).formula == Formula::Quadratic(1, 0, 0));
+    TEST_ASSERT_EQUAL_DOUBLE(-3.5, low(3.5));
+
+    SegmentFunction<double> square;
+    square.Define(0.0, 2.0, Formula::Quadratic(1, 0, 0));
+    SegmentFunction<double> composition = f.Compose(square);
+    TEST_ASSERT_EQUAL(2, composition.GetSize());
+    TEST_ASSERT_DOUBLE_WITHIN(1e-12, sqrt(2.0), composition.Get(0).end);
+    TEST_ASSERT_TRUE(composition.Get(0).formula == Formula::Quadratic(1, 0, 0));
+    TEST_ASSERT_TRUE(composition.Get(1).formula == Formula::Constant(2));
+    TEST_ASSERT_EQUAL_DOUBLE(1.0, composition(1.0));
+    TEST_ASSERT_EQUAL_DOUBLE(2.0, composition(1.9));
+
+    SegmentFunction<double> sine, wave;
+    sine.Define(-10.0, 10.0, Formula::Sine(1, 1, 0, 0));
+    wave = sine.Compose(h);
+    TEST_ASSERT_EQUAL(1, wave.GetSize());
+    TEST_ASSERT_EQUAL_DOUBLE(4.0, wave.Get(0).end);
+    TEST_ASSERT_TRUE(wave.Get(0).formula == Formula::Sine(1, 2, 1, 0));
+    SegmentFunction<double> clipped = g.Compose(h);
+    TEST_ASSERT_EQUAL(2, clipped.GetSize());
+    TEST_ASSERT_EQUAL_DOUBLE(0.0, clipped.Get(0).start);
+    TEST_ASSERT_TRUE(clipped.Get(0).formula == Formula::Quadratic(4, 4, 1));
+    TEST_ASSERT_EQUAL_DOUBLE(2.0, clipped.Get(1).end);
+    TEST_ASSERT_EQUAL_DOUBLE(-4.0, clipped(1.5));
+
+    SegmentFunction<double> steps, bump;
+    steps.Define(0.0, 1.0, Formula::Constant(5));
+    steps.Define(1.0, 2.0, Formula::Constant(7));
+    bump.Define(-1.0, 1.0, Formula::Quadratic(-1, 0, 1));
+    SegmentFunction<double> touching = steps.Compose(bump);
+    TEST_ASSERT_EQUAL_DOUBLE(5.0, touching(0.5));
+    TEST_ASSERT_EQUAL_DOUBLE(5.0, touching(-0.9));
+    SegmentFunction<double> outer, peak;
+    outer.Define(0.0, 1.0, Formula::Hyperbolic(1, 1, 0));
+    outer.Define(1.0, 3.0, Formula::Linear(2, 0));
+    peak.Define(0.0, acos(-1.0), Formula::Sine(1, 1, 0, 0));
+    SegmentFunction<double> arch = outer.Compose(peak);
+    TEST_ASSERT_DOUBLE_WITHIN(1e-12, 1/(sin(0.5)+1), arch(0.5));
+    TEST_ASSERT_DOUBLE_WITHIN(1e-12, 1/(sin(2.5)+1), arch(2.5));
+    SegmentFunction<double> valley;
+    valley.Define(-1.0, 1.0, Formula::Quadratic(1, 0, 1));
+    TEST_ASSERT_EQUAL_DOUBLE(7.0, steps.Compose(valley)(0.5));
+}
+
+void closure_flattening(void) {
+    SegmentFunction<double> f, g;
+    f.Define(0.0, 2.0, [](double x) {return x+1;});
+    g.Define(1.0, 3.0, Formula::Quadratic(1, 0, 0));
+    auto zip = f.Zip(g);
+    auto [first, second] = SegmentFunction<double>::Unzip(zip);
+    TEST_ASSERT_EQUAL(1, first.GetSize());
+    TEST_ASSERT_TRUE(first.Get(0).func.target_type() == f.Get(0).func.target_type());
+    TEST_ASSERT_TRUE(second.Get(0).formula == Formula::Quadratic(1, 0, 0));
+    TEST_ASSERT_EQUAL_DOUBLE(2.5, first(1.5));
+    TEST_ASSERT_EQUAL_DOUBLE(2.25, second(1.5));
+
+    SegmentFunction<pair<double, double>> points;
+    points.Define(0.0, 1.0, [](double x) {return make_pair(x, -x);});
+    auto [xs, ys] = SegmentFunction<double>::Unzip(points);
+    TEST_ASSERT_EQUAL_DOUBLE(-0.5, ys(0.5));
+    auto rezip = xs.Zip(ys);
+    TEST_ASSERT_TRUE(rezip.Get(0).func.target_type() == points.Get(0).func.target_type());
+    TEST_ASSERT_EQUAL_DOUBLE(0.25, rezip(0.25).first);
+
+    SegmentFunction<double> a, b, c, line;
+    a.Define(0.0, 1.0, [](double x) {return x;});
+    b.Define(0.0, 1.0, [](double x) {return 2*x;});
+    c.Define(0.0, 1.0, [](double x) {return x*x;});
+    line.Define(0.0, 1.0, Formula::Linear(3, 1));
+    SegmentFunction<double> sum = ((a+line)+(b-c))-(line+c);
+    const ChainNode<double> *chain = dynamic_cast<const ChainNode<double>*>(sum.Get(0).node.get());
+    TEST_ASSERT_NOT_NULL(chain);
+    TEST_ASSERT_TRUE(chain->operation == Operation::Add);
+    TEST_ASSERT_EQUAL(4, chain->terms.GetSize());
+    TEST_ASSERT_DOUBLE_WITHIN(1e-12, 3*0.5-2*0.25, sum(0.5));
+    SegmentFunction<double> product = (a*b)*(c*line);
+    TEST_ASSERT_EQUAL(4, dynamic_cast<const ChainNode<double>*>(product.Get(0).node.get())->terms.GetSize());
+    TEST_ASSERT_DOUBLE_WITHIN(1e-12, 0.5*1*0.25*2.5, product(0.5));
+    TEST_ASSERT_DOUBLE_WITHIN(1e-12, 0.25, Min(Min(a, b), c)(0.5));
+    TEST_ASSERT_TRUE(((a+b)*c).Get(0).node != nullptr);
+    TEST_ASSERT_DOUBLE_WITHIN(1e-12, 0.375, ((a+b)*c)(0.5));
+}
+
+void expression_segments(void) {
+    Expression expression = Expression::Parse("exp(sin(x))*cos(x/3) / (1 + log(1+x)) - .5*x^2");
+    auto native = [](double x) {return exp(sin(x))*cos(x/3)/(1+log(1+x))-0.5*x*x;};
+    double xs[200], values[200];
+    for (int i = 0; i < 200; i++) xs[i] = i/20.0+0.01;
+    expression.Evaluate(xs, 200, values);
+    for (int i = 0; i < 200; i++) {
+        TEST_ASSERT_DOUBLE_WITHIN(1e-12, native(xs[i]), expression(xs[i]));
+        TEST_ASSERT_DOUBLE_WITHIN(1e-12, native(xs[i]), values[i]);
+    }
+    TEST_ASSERT_EQUAL_DOUBLE(-8.0, Expression::Parse("-2^3")(0));
+    TEST_ASSERT_EQUAL_DOUBLE(512.0, Expression::Parse("2^3^2")(0));
+    TEST_ASSERT_EQUAL_DOUBLE(2.0, Expression::Parse("max(x, 3) - min(x, 1) + pi - pi")(1));
+    TEST_ASSERT_EQUAL(0, Expression::Parse("2*pi+1").GetInstructions());
+    TEST_ASSERT_EQUAL(1, Expression::Parse("x^2").GetInstructions());
+    for (const char *text: {"", "x+", "sin x", "y", "(x", "x)", "2..3", "pow(x)"}) {
+        try {
+            Expression::Parse(text);
+            TEST_FAIL();
+        } catch (const invalid_argument&) {}
+    }
+
+    SegmentFunction<double> segFunc;
+    segFunc.Define(0.0, 5.0, expression);
+    segFunc.Define(5.0, 10.0, Expression::Parse("x"));
+    segFunc.Define(10.0, 11.0, [](double x) {return x;});
+    TEST_ASSERT_EQUAL_DOUBLE(native(2.5), segFunc(2.5));
+    TEST_ASSERT_TRUE(segFunc.IsContinuous() == false);
+    double points[6] = {1.0, 2.0, 5.0, 7.0, 10.5, 12.0}, results[6];
+    EvaluationStatus statuses[6];
+    segFunc.ResetLookupStatistics();
+    TEST_ASSERT_EQUAL(4, segFunc.TryCalculateAt(points, 6, results, statuses));
+    TEST_ASSERT_EQUAL(5, segFunc.GetLookupStatistics().Total());
+    for (int pass = 0; pass < 3; pass++) {
+        TEST_ASSERT_EQUAL_DOUBLE(native(1.0), results[0]);
+        TEST_ASSERT_EQUAL_DOUBLE(native(2.0), results[1]);
+        TEST_ASSERT_TRUE(statuses[2] == EvaluationStatus::Discontinuity);
+        TEST_ASSERT_EQUAL_DOUBLE(7.0, results[3]);
+        TEST_ASSERT_EQUAL_DOUBLE(10.5, results[4]);
+        TEST_ASSERT_TRUE(statuses[5] == EvaluationStatus::Undefined);
+        if (pass == 0) segFunc.EnableCache(16);
+        TEST_ASSERT_EQUAL(4, segFunc.TryCalculateAt(points, 6, results, statuses));
+    }
+    TEST_ASSERT_EQUAL(4, segFunc.GetCacheStatistics().hits);
+}
+
+void serialization(void) {
+    SegmentFunction<double> segFunc;
+    segFunc.Define(-3.0, -1.0, Formula::Constant(2.5));
+    segFunc.Define(-1.0, 0.5, Formula::Linear(-2.0, 0.1));
+    segFunc.Define(1.0, 2.0, Formula::Quadratic(1.5, -1.0, 0.25));
+    segFunc.Define(2.0, 3.0, Formula::Hyperbolic(2.0, 1.0, -0.5));
+    segFunc.Define(3.0, 4.0, Formula::Power(0.5));
+    segFunc.Define(4.0, 6.0, Formula::Sine(1.5, 2.0, 0.3, 1.0/3));
+    segFunc.Define(6.0, 7.0, Expression::Parse("exp(-x)*sin(3*x)"));
+    segFunc.Define(7.0, 8.0, Expression::Parse("exp(-x)*sin(3*x)"));
+
+    stringstream stream;
+    segFunc.Save(stream);
+    string bytes = stream.str();
+    TEST_ASSERT_EQUAL_MEMORY("SGFN\x01\x00\x00\x00\x08\x00", bytes.data(), 10);
+    SegmentFunction<double> loaded = SegmentFunction<double>::Load(stream);
+    TEST_ASSERT_EQUAL(segFunc.GetSize(), loaded.GetSize());
+    for (size_t i = 0; i < segFunc.GetSize(); i++) {
+        Segment<double> expected = segFunc.Get(i), actual = loaded.Get(i);
+        TEST_ASSERT_EQUAL_DOUBLE(expected.start, actual.start);
+        TEST_ASSERT_EQUAL_DOUBLE(expected.end, actual.end);
+        TEST_ASSERT_TRUE(expected.formula == actual.formula);
+        for (int k = 0; k <= 10; k++) {
+            double x = expected.start+(expected.end-expected.start)*k/10;
+            TEST_ASSERT_EQUAL_DOUBLE(expected.func(x), actual.func(x));
+        }
+    }
+    TEST_ASSERT_TRUE(loaded.Get(6).node == loaded.Get(7).node);
+    TEST_ASSERT_TRUE(segFunc.IsContinuous() == loaded.IsContinuous());
+
+    SegmentFunction<double> empty;
+    stringstream emptyStream;
+    empty.Save(emptyStream);
+    TEST_ASSERT_EQUAL(0, SegmentFunction<double>::Load(emptyStream).GetSize());
+
+    segFunc.Define(8.0, 9.0, [](double x) {return x;});
+    stringstream opaque;
+    try {
+        segFunc.Save(opaque);
+        TEST_FAIL();
+    } catch (const invalid_argument&) {}
+    TEST_ASSERT_EQUAL(0, opaque.str().size());
+    for (string broken: {string("SGFX\x01\x00\x00\x00", 8)+string(8, '\0'), string("SGFN\x02\x00\x00\x00", 8)+string(8, '\0'),
+                         bytes.substr(0, bytes.size()-3), bytes.substr(0, 32)+'\x07'+bytes.substr(33),
+                         string("SGFN\x01\x00\x00\x00\x01", 9)+string(23, '\0')+"\x80\xff\xff\xff\xffx"}) {
+        stringstream input(broken);
+        try {
+            SegmentFunction<double>::Load(input);
+            TEST_FAIL();
+        } catch (const runtime_error&) {}
+    }
+}
+
+void mapped_tables(void) {
+    SegmentFunction<double> segFunc;
+    segFunc.Define(0.0, 1.0, Formula::Linear(2.0, 1.0));
+    segFunc.Define(1.0, 2.0, Formula::Constant(3.0));
+    segFunc.Define(2.0, 3.0, Formula::Quadratic(1.0, 0.0, 0.5));
+    segFunc.Define(4.0, 6.0, Formula::Sine(2.0, 0.5, 0.1, 1.0));
+    const char *path = "mapped_tables.sgfn";
+    {
+        ofstream out(path, ios::binary);
+        segFunc.Save(out, true);
+    }
+
+    MappedSegmentFunction mapped(path);
+    TEST_ASSERT_EQUAL(4, mapped.GetSize());
+    TEST_ASSERT_EQUAL_DOUBLE(2.0, mapped(0.5));
+    TEST_ASSERT_EQUAL_DOUBLE(3.0, mapped(1.0));
+    TEST_ASSERT_EQUAL_DOUBLE(segFunc(5.0), mapped(5.0));
+    TEST_ASSERT_EQUAL(1, mapped.FindSegment(2.0));
+    TEST_ASSERT_EQUAL(4, mapped.FindSegment(3.5));
+    double value;
+    TEST_ASSERT_TRUE(mapped.TryCalculateAt(2.0, value) == EvaluationStatus::Discontinuity);
+    TEST_ASSERT_TRUE(mapped.TryCalculateAt(3.5, value) == EvaluationStatus::Undefined);
+    try {
+        mapped(3.5);
+        TEST_FAIL();
+    } catch (const out_of_range &error) {
+        TEST_ASSERT_EQUAL_STRING("Функция не определена в точке x = 3.50!", error.what());
+    }
+    double points[7] = {0.25, 0.75, 1.5, 2.0, 2.5, 3.5, 6.0}, results[7];
+    EvaluationStatus statuses[7];
+    TEST_ASSERT_EQUAL(5, mapped.TryCalculateAt(points, 7, results, statuses));
+    for (int i = 0; i < 7; i++) {
+        EvaluationStatus status = segFunc.TryCalculateAt(points[i], value);
+        TEST_ASSERT_TRUE(status == statuses[i]);
+        if (status == EvaluationStatus::Defined) TEST_ASSERT_EQUAL_DOUBLE(value, results[i]);
+    }
+    Segment<double> segment = mapped.Get(3);
+    TEST_ASSERT_TRUE(segment.formula == segFunc.Get(3).formula);
+    TEST_ASSERT_EQUAL_DOUBLE(segFunc(4.0), segment.startValue);
+
+    ifstream in(path, ios::binary);
+    TEST_ASSERT_EQUAL(4, SegmentFunction<double>::Load(in).GetSize());
+    in.close();
+
+    segFunc.Define(6.0, 7.0, Expression::Parse("x"));
+    stringstream stream;
+    try {
+        segFunc.Save(stream, true);
+        TEST_FAIL();
+    } catch (const invalid_argument&) {}
+    {
+        ofstream out(path, ios::binary);
+        segFunc.Save(out);
+    }
+    try {
+        MappedSegmentFunction unfrozen(path);
+        TEST_FAIL();
+    } catch (const runtime_error&) {}
+    remove(path);
+    try {
+        MappedSegmentFunction missing(path);
+        TEST_FAIL();
+    } catch (const runtime_error&) {}
+}
+
+void csv_import(void) {
+    string text = "start,end,kind,a,b,c,d\r\n"
+                  "# комментарий\r\n"
+                  "0, 1, linear, 2, 1\r\n"
+                  "\r\n"
+                  "1,2,constant,3\n"
+                  "2,3,quadratic,1,0,-1.5e-1\n"
+                  "4,6,sine,2,0.5,0.1,1\n"
+                  "6,7,hyperbolic,2,1,-0.5\n"
+                  "7,8,power,0.5";
+    stringstream stream(text);
+    SegmentFunction<double> segFunc = SegmentFunction<double>::Import(stream);
+    TEST_ASSERT_EQUAL(6, segFunc.GetSize());
+    TEST_ASSERT_EQUAL_DOUBLE(2.0, segFunc(0.5));
+    TEST_ASSERT_EQUAL_DOUBLE(3.0, segFunc(1.5));
+    TEST_ASSERT_EQUAL_DOUBLE(6.25-0.15, segFunc(2.5));
+    TEST_ASSERT_EQUAL_DOUBLE(2*sin(2.6)+1, segFunc(5.0));
+    TEST_ASSERT_EQUAL_DOUBLE(2/7.5-0.5, segFunc(6.5));
+    TEST_ASSERT_EQUAL_DOUBLE(sqrt(7.5), segFunc(7.5));
+
+    string big;
+    for (int i = 0; i < 20000; i++) big += to_string(i) + "," + to_string(i+1) + ",linear,0.5," + to_string(i) + "\n";
+    for (bool parallel: {false, true}) {
+        stringstream input(big);
+        CsvReader reader(input, parallel, 100);
+        DynamicArray<CsvRow> rows;
+        size_t count = 0;
+        while (reader.Next(rows, count)) {}
+        TEST_ASSERT_EQUAL(20000, count);
+        TEST_ASSERT_EQUAL(20000, reader.GetLines());
+        TEST_ASSERT_EQUAL(big.size(), reader.GetBytes());
+        TEST_ASSERT_EQUAL(12346, rows[12345].line);
+        TEST_ASSERT_EQUAL_DOUBLE(12345.0, rows[12345].start);
+        TEST_ASSERT_EQUAL_DOUBLE(12345.0, rows[12345].formula.b);
+        stringstream whole(big);
+        TEST_ASSERT_EQUAL_DOUBLE(0.5*15000.5+15000, SegmentFunction<double>::Import(whole, parallel)(15000.5));
+    }
+
+    pair<const char*, const char*> broken[5] = {{"0,1,linear,1,2\n1,2,linear,1\n", "(строка 2)"},
+                                                {"0,1,linear,1,2\n1,x,constant,1\n", "(строка 2)"},
+                                                {"0,1,cubic,1\n", "(строка 1)"},
+                                                {"0,1,constant,1\n\n0.5,2,constant,1\n", "(строка 3)"},
+                                                {"0,1,constant,1\n2,1,constant,1\n", "(строка 2)"}};
+    for (const auto &item: broken) {
+        stringstream input(item.first);
+        try {
+            SegmentFunction<double>::Import(input);
+            TEST_FAIL();
+        } catch (const invalid_argument &error) {
+            TEST_ASSERT_NOT_NULL(strstr(error.what(), item.second));
+        }
+    }
+}
+
 int run_tests(void) {
     UNITY_BEGIN();
 
@@ -168,6 +1021,27 @@ int run_tests(void) {
     RUN_TEST(test4);
     RUN_TEST(test5);
     RUN_TEST(test6);
+    RUN_TEST(segment_index);
+    RUN_TEST(lookup_cursor);
+    RUN_TEST(evaluation_cache);
+    RUN_TEST(segment_ids);
+    RUN_TEST(try_calculate);
+    RUN_TEST(junction_index);
+    RUN_TEST(incremental_monotony);
+    RUN_TEST(analytic_monotony);
+    RUN_TEST(analyze_all);
+    RUN_TEST(integrate);
+    RUN_TEST(integral_index);
+    RUN_TEST(solve);
+    RUN_TEST(range_extrema);
+    RUN_TEST(compile_chebyshev);
+    RUN_TEST(compact_segments);
+    RUN_TEST(function_algebra);
+    RUN_TEST(closure_flattening);
+    RUN_TEST(expression_segments);
+    RUN_TEST(serialization);
+    RUN_TEST(mapped_tables);
+    RUN_TEST(csv_import);
 
     // Дополнительные функции
     RUN_TEST(map_where_reduce);